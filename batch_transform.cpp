@@ -0,0 +1,171 @@
+/*===================================================
+// Batched point transforms with runtime SIMD dispatch
+//===================================================*/
+
+#include "batch_transform.hpp"
+#include "batch_transform_kernels.hpp"
+#include <cstdint>
+#include <glm/gtc/type_ptr.hpp>
+#if defined(BATCH_TRANSFORM_AVX) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The SSE2 kernels are compiled here, with the baseline instruction set.
+// AVX2 and AVX-512 get their own files so that only those are built for
+// them, and are only reached after the CPU check below.
+
+using namespace std;
+using namespace glm;
+
+#if BATCH_TRANSFORM_SSE2
+BATCH_ENTRY_POINTS(Sse2, sse2)
+#endif
+
+namespace {
+
+// The scalar entry points ignore alignment.
+void soa_none(const float *m, const float *x, const float *y, const float *z,
+              size_t count, float *outX, float *outY, float *outZ,
+              float *outW, bool)
+{
+    soa_scalar(m, x, y, z, count, outX, outY, outZ, outW);
+}
+
+void aos4_none(const float *m, const float *in, size_t count, float *out, bool)
+{
+    aos4_scalar(m, in, count, out);
+}
+
+void aos3_none(const float *m, const float *in, size_t count, float *out, bool)
+{
+    aos3_scalar(m, in, count, out);
+}
+
+struct BatchKernels {
+    BatchTransformIsa isa;
+    size_t alignment;   // bytes for the aligned variants
+    void (*soa)(const float*, const float*, const float*, const float*, size_t,
+                float*, float*, float*, float*, bool);
+    void (*aos4)(const float*, const float*, size_t, float*, bool);
+    void (*aos3)(const float*, const float*, size_t, float*, bool);
+};
+
+const BatchKernels kernelTable[] = {
+    { BATCH_SCALAR, 1, soa_none, aos4_none, aos3_none },
+#if BATCH_TRANSFORM_SSE2
+    { BATCH_SSE2, 16, batch_soa_sse2, batch_aos4_sse2, batch_aos3_sse2 },
+#ifdef BATCH_TRANSFORM_AVX
+    { BATCH_AVX2, 32, batch_soa_avx2, batch_aos4_avx2, batch_aos3_avx2 },
+    { BATCH_AVX512, 64, batch_soa_avx512, batch_aos4_avx512, batch_aos3_avx512 },
+#endif
+#endif
+};
+
+BatchTransformIsa detect_isa()
+{
+#if BATCH_TRANSFORM_SSE2 && defined(BATCH_TRANSFORM_AVX) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return BATCH_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return BATCH_AVX2;
+    return BATCH_SSE2;
+#elif BATCH_TRANSFORM_SSE2 && defined(BATCH_TRANSFORM_AVX)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return BATCH_SSE2;
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    // the OS must save the YMM (and for AVX-512, the ZMM and mask) state
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+        return BATCH_AVX512;
+    if ((info[1] & (1 << 5)) && fma && (xcr0 & 0x6) == 0x6)
+        return BATCH_AVX2;
+    return BATCH_SSE2;
+#elif BATCH_TRANSFORM_SSE2
+    return BATCH_SSE2;
+#else
+    return BATCH_SCALAR;
+#endif
+}
+
+// Function statics, so transforms during static initialization still work.
+BatchTransformIsa best_isa()
+{
+    static BatchTransformIsa isa = detect_isa();
+    return isa;
+}
+
+const BatchKernels*& active_kernels()
+{
+    static const BatchKernels *kernels = &kernelTable[best_isa()];
+    return kernels;
+}
+
+inline bool aligned_to(const void *p, size_t alignment)
+{
+    return p == NULL || (uintptr_t(p) & (alignment - 1)) == 0;
+}
+
+} // namespace
+
+BatchTransformIsa batch_transform_isa()
+{
+    return active_kernels()->isa;
+}
+
+const char* batch_transform_isa_name(BatchTransformIsa isa)
+{
+    switch (isa) {
+    case BATCH_SSE2: return "sse2";
+    case BATCH_AVX2: return "avx2";
+    case BATCH_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+bool batch_transform_isa_supported(BatchTransformIsa isa)
+{
+    return isa >= BATCH_SCALAR && isa <= best_isa();
+}
+
+bool set_batch_transform_isa(BatchTransformIsa isa)
+{
+    if (!batch_transform_isa_supported(isa))
+        return false;
+    active_kernels() = &kernelTable[isa];
+    return true;
+}
+
+void transform_points(const mat4 &m, const vec3 *in, size_t count, vec4 *out)
+{
+    const BatchKernels *k = active_kernels();
+    k->aos4(value_ptr(m), reinterpret_cast<const float*>(in), count,
+            reinterpret_cast<float*>(out),
+            aligned_to(in, k->alignment) && aligned_to(out, k->alignment));
+}
+
+void transform_points_project(const mat4 &m, const vec3 *in, size_t count,
+                              vec3 *out)
+{
+    const BatchKernels *k = active_kernels();
+    k->aos3(value_ptr(m), reinterpret_cast<const float*>(in), count,
+            reinterpret_cast<float*>(out),
+            aligned_to(in, k->alignment) && aligned_to(out, k->alignment));
+}
+
+void transform_points_soa(const mat4 &m, const float *x, const float *y,
+                          const float *z, size_t count, float *outX,
+                          float *outY, float *outZ, float *outW)
+{
+    const BatchKernels *k = active_kernels();
+    size_t a = k->alignment;
+    bool aligned = aligned_to(x, a) && aligned_to(y, a) && aligned_to(z, a) &&
+                   aligned_to(outX, a) && aligned_to(outY, a) &&
+                   aligned_to(outZ, a) && aligned_to(outW, a);
+    k->soa(value_ptr(m), x, y, z, count, outX, outY, outZ, outW, aligned);
+}
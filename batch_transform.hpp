@@ -0,0 +1,45 @@
+/*===================================================
+// Batched point transforms with runtime SIMD dispatch
+//===================================================*/
+
+// glm's simd/matrix.h transforms one vec4 per call. These transform whole
+// arrays of points by one mat4, using the widest instruction set the CPU
+// has (SSE2, AVX2 or AVX-512), picked once at run time, so one binary runs
+// everywhere. Aligned loads and stores are used whenever every array is
+// aligned to the vector width, unaligned ones otherwise.
+
+#ifndef BATCH_TRANSFORM_HPP
+#define BATCH_TRANSFORM_HPP
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+enum BatchTransformIsa {
+    BATCH_SCALAR, BATCH_SSE2, BATCH_AVX2, BATCH_AVX512
+};
+
+// The instruction set in use: the best one supported unless overridden.
+BatchTransformIsa batch_transform_isa();
+const char* batch_transform_isa_name(BatchTransformIsa isa);
+bool batch_transform_isa_supported(BatchTransformIsa isa);
+
+// Forces an instruction set, e.g. to compare them; returns false and leaves
+// the current one if the CPU lacks it.
+bool set_batch_transform_isa(BatchTransformIsa isa);
+
+// out[i] = m * vec4(in[i], 1).
+void transform_points(const glm::mat4 &m, const glm::vec3 *in, size_t count,
+                      glm::vec4 *out);
+
+// The same followed by the perspective divide: out[i] = xyz / w.
+void transform_points_project(const glm::mat4 &m, const glm::vec3 *in,
+                              size_t count, glm::vec3 *out);
+
+// Structure-of-arrays form: one array per coordinate in and out. With
+// outW NULL the results are divided by w instead of returning it. Output
+// arrays must not overlap the inputs unless they are the same arrays.
+void transform_points_soa(const glm::mat4 &m, const float *x, const float *y,
+                          const float *z, size_t count, float *outX,
+                          float *outY, float *outZ, float *outW);
+
+#endif // BATCH_TRANSFORM_HPP
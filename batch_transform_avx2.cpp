@@ -0,0 +1,57 @@
+/*===================================================
+// Batch transform kernels for AVX2 with FMA
+//===================================================*/
+
+// Compiled with AVX2 and FMA enabled; only called once batch_transform.cpp
+// has checked that the CPU has them.
+
+#include "batch_transform_kernels.hpp"
+
+namespace {
+
+struct Avx2 {
+    typedef __m256 V;
+    enum { W = 8 };
+    template<bool A> static V load(const float *p)
+    { return A ? _mm256_load_ps(p) : _mm256_loadu_ps(p); }
+    template<bool A> static void store(float *p, V v)
+    { if (A) _mm256_store_ps(p, v); else _mm256_storeu_ps(p, v); }
+    static V set1(float f) { return _mm256_set1_ps(f); }
+    static V madd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    template<int I> static V shuffle(V a, V b) { return _mm256_shuffle_ps(a, b, I); }
+    static V unpacklo(V a, V b) { return _mm256_unpacklo_ps(a, b); }
+    static V unpackhi(V a, V b) { return _mm256_unpackhi_ps(a, b); }
+    template<bool A> static V join(const float *lo, const float *hi)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(Sse2::load<A>(lo)),
+                                    Sse2::load<A>(hi), 1);
+    }
+    template<bool A> static void load3(const float *p, V &a, V &b, V &c)
+    {
+        a = join<A>(p, p + 12);
+        b = join<A>(p + 4, p + 16);
+        c = join<A>(p + 8, p + 20);
+    }
+    template<bool A> static void store3(float *p, V a, V b, V c)
+    {
+        Sse2::store3<A>(p, _mm256_castps256_ps128(a),
+                        _mm256_castps256_ps128(b), _mm256_castps256_ps128(c));
+        Sse2::store3<A>(p + 12, _mm256_extractf128_ps(a, 1),
+                        _mm256_extractf128_ps(b, 1),
+                        _mm256_extractf128_ps(c, 1));
+    }
+    // lane k of r_i is point 4k+i
+    template<bool A> static void store4(float *p, V r0, V r1, V r2, V r3)
+    {
+        store<A>(p, _mm256_permute2f128_ps(r0, r1, 0x20));
+        store<A>(p + 8, _mm256_permute2f128_ps(r2, r3, 0x20));
+        store<A>(p + 16, _mm256_permute2f128_ps(r0, r1, 0x31));
+        store<A>(p + 24, _mm256_permute2f128_ps(r2, r3, 0x31));
+    }
+};
+
+} // namespace
+
+BATCH_ENTRY_POINTS(Avx2, avx2)
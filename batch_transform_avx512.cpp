@@ -0,0 +1,69 @@
+/*===================================================
+// Batch transform kernels for AVX-512
+//===================================================*/
+
+// Compiled with AVX-512F enabled; only called once batch_transform.cpp has
+// checked that the CPU and OS support it.
+
+#include "batch_transform_kernels.hpp"
+
+namespace {
+
+struct Avx512 {
+    typedef __m512 V;
+    enum { W = 16 };
+    template<bool A> static V load(const float *p)
+    { return A ? _mm512_load_ps(p) : _mm512_loadu_ps(p); }
+    template<bool A> static void store(float *p, V v)
+    { if (A) _mm512_store_ps(p, v); else _mm512_storeu_ps(p, v); }
+    static V set1(float f) { return _mm512_set1_ps(f); }
+    static V madd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    template<int I> static V shuffle(V a, V b) { return _mm512_shuffle_ps(a, b, I); }
+    static V unpacklo(V a, V b) { return _mm512_unpacklo_ps(a, b); }
+    static V unpackhi(V a, V b) { return _mm512_unpackhi_ps(a, b); }
+    template<bool A> static V join(const float *p)
+    {
+        V v = _mm512_castps128_ps512(Sse2::load<A>(p));
+        v = _mm512_insertf32x4(v, Sse2::load<A>(p + 12), 1);
+        v = _mm512_insertf32x4(v, Sse2::load<A>(p + 24), 2);
+        return _mm512_insertf32x4(v, Sse2::load<A>(p + 36), 3);
+    }
+    template<bool A> static void load3(const float *p, V &a, V &b, V &c)
+    { a = join<A>(p); b = join<A>(p + 4); c = join<A>(p + 8); }
+    template<bool A> static void store3(float *p, V a, V b, V c)
+    {
+        Sse2::store3<A>(p, _mm512_castps512_ps128(a),
+                        _mm512_castps512_ps128(b), _mm512_castps512_ps128(c));
+        Sse2::store3<A>(p + 12, _mm512_extractf32x4_ps(a, 1),
+                        _mm512_extractf32x4_ps(b, 1),
+                        _mm512_extractf32x4_ps(c, 1));
+        Sse2::store3<A>(p + 24, _mm512_extractf32x4_ps(a, 2),
+                        _mm512_extractf32x4_ps(b, 2),
+                        _mm512_extractf32x4_ps(c, 2));
+        Sse2::store3<A>(p + 36, _mm512_extractf32x4_ps(a, 3),
+                        _mm512_extractf32x4_ps(b, 3),
+                        _mm512_extractf32x4_ps(c, 3));
+    }
+    // lane k of r_i is point 4k+i; gather lane k of all four into p + 16k
+    template<bool A> static void store4(float *p, V r0, V r1, V r2, V r3)
+    {
+        V even01 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(2, 0, 2, 0));
+        V even23 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(2, 0, 2, 0));
+        V odd01 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(3, 1, 3, 1));
+        V odd23 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(3, 1, 3, 1));
+        store<A>(p, _mm512_shuffle_f32x4(even01, even23,
+                                         _MM_SHUFFLE(2, 0, 2, 0)));
+        store<A>(p + 16, _mm512_shuffle_f32x4(odd01, odd23,
+                                              _MM_SHUFFLE(2, 0, 2, 0)));
+        store<A>(p + 32, _mm512_shuffle_f32x4(even01, even23,
+                                              _MM_SHUFFLE(3, 1, 3, 1)));
+        store<A>(p + 48, _mm512_shuffle_f32x4(odd01, odd23,
+                                              _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+};
+
+} // namespace
+
+BATCH_ENTRY_POINTS(Avx512, avx512)
@@ -0,0 +1,250 @@
+/*===================================================
+// Batch transform kernels shared by the per-ISA files
+//===================================================*/
+
+// Private to batch_transform*.cpp. Each of those files is compiled for its
+// own instruction set and instantiates the kernels below with its vector
+// operations, so everything here has internal linkage: an AVX build of a
+// helper must never be the copy the linker keeps for the baseline code.
+// No glm here for the same reason.
+
+#ifndef BATCH_TRANSFORM_KERNELS_HPP
+#define BATCH_TRANSFORM_KERNELS_HPP
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_TRANSFORM_SSE2 1
+#include <immintrin.h>
+#else
+#define BATCH_TRANSFORM_SSE2 0
+#endif
+
+namespace {
+
+// m is column-major, as glm::value_ptr gives it.
+inline void transform_one(const float *m, float x, float y, float z,
+                          float &ox, float &oy, float &oz, float &ow)
+{
+    ox = m[0] * x + (m[4] * y + (m[8] * z + m[12]));
+    oy = m[1] * x + (m[5] * y + (m[9] * z + m[13]));
+    oz = m[2] * x + (m[6] * y + (m[10] * z + m[14]));
+    ow = m[3] * x + (m[7] * y + (m[11] * z + m[15]));
+}
+
+inline void soa_scalar(const float *m, const float *x, const float *y,
+                       const float *z, size_t count, float *outX,
+                       float *outY, float *outZ, float *outW)
+{
+    for (size_t i = 0; i < count; i++) {
+        float ox, oy, oz, ow;
+        transform_one(m, x[i], y[i], z[i], ox, oy, oz, ow);
+        if (outW) {
+            outX[i] = ox; outY[i] = oy; outZ[i] = oz; outW[i] = ow;
+        } else {
+            float inv = 1.0f / ow;
+            outX[i] = ox * inv; outY[i] = oy * inv; outZ[i] = oz * inv;
+        }
+    }
+}
+
+inline void aos4_scalar(const float *m, const float *in, size_t count,
+                        float *out)
+{
+    for (size_t i = 0; i < count; i++, in += 3, out += 4)
+        transform_one(m, in[0], in[1], in[2], out[0], out[1], out[2], out[3]);
+}
+
+inline void aos3_scalar(const float *m, const float *in, size_t count,
+                        float *out)
+{
+    for (size_t i = 0; i < count; i++, in += 3, out += 3) {
+        float ox, oy, oz, ow;
+        transform_one(m, in[0], in[1], in[2], ox, oy, oz, ow);
+        float inv = 1.0f / ow;
+        out[0] = ox * inv; out[1] = oy * inv; out[2] = oz * inv;
+    }
+}
+
+#if BATCH_TRANSFORM_SSE2
+
+// Each instruction set provides the same operations on a vector V of W
+// floats. Shuffles and unpacks work within 128-bit lanes, and the AoS
+// loads and stores put points 4k..4k+3 in lane k, so the same shuffle
+// sequences deinterleave and transpose at every width.
+struct Sse2 {
+    typedef __m128 V;
+    enum { W = 4 };
+    template<bool A> static V load(const float *p)
+    { return A ? _mm_load_ps(p) : _mm_loadu_ps(p); }
+    template<bool A> static void store(float *p, V v)
+    { if (A) _mm_store_ps(p, v); else _mm_storeu_ps(p, v); }
+    static V set1(float f) { return _mm_set1_ps(f); }
+    static V madd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    template<int I> static V shuffle(V a, V b) { return _mm_shuffle_ps(a, b, I); }
+    static V unpacklo(V a, V b) { return _mm_unpacklo_ps(a, b); }
+    static V unpackhi(V a, V b) { return _mm_unpackhi_ps(a, b); }
+    template<bool A> static void load3(const float *p, V &a, V &b, V &c)
+    { a = load<A>(p); b = load<A>(p + 4); c = load<A>(p + 8); }
+    template<bool A> static void store3(float *p, V a, V b, V c)
+    { store<A>(p, a); store<A>(p + 4, b); store<A>(p + 8, c); }
+    template<bool A> static void store4(float *p, V r0, V r1, V r2, V r3)
+    {
+        store<A>(p, r0); store<A>(p + 4, r1);
+        store<A>(p + 8, r2); store<A>(p + 12, r3);
+    }
+};
+
+template<class S> struct Matrix {
+    typedef typename S::V V;
+    V c[16];
+
+    explicit Matrix(const float *m)
+    {
+        for (int i = 0; i < 16; i++)
+            c[i] = S::set1(m[i]);
+    }
+
+    void apply(V x, V y, V z, V &ox, V &oy, V &oz, V &ow) const
+    {
+        ox = S::madd(c[0], x, S::madd(c[4], y, S::madd(c[8], z, c[12])));
+        oy = S::madd(c[1], x, S::madd(c[5], y, S::madd(c[9], z, c[13])));
+        oz = S::madd(c[2], x, S::madd(c[6], y, S::madd(c[10], z, c[14])));
+        ow = S::madd(c[3], x, S::madd(c[7], y, S::madd(c[11], z, c[15])));
+    }
+};
+
+template<class S, bool A>
+void soa_kernel(const float *m, const float *x, const float *y, const float *z,
+                size_t count, float *outX, float *outY, float *outZ,
+                float *outW)
+{
+    typedef typename S::V V;
+    Matrix<S> mat(m);
+    V one = S::set1(1.0f);
+    size_t i = 0;
+    for (; i + S::W <= count; i += S::W) {
+        V ox, oy, oz, ow;
+        mat.apply(S::template load<A>(x + i), S::template load<A>(y + i),
+                  S::template load<A>(z + i), ox, oy, oz, ow);
+        if (outW) {
+            S::template store<A>(outW + i, ow);
+        } else {
+            V inv = S::div(one, ow);
+            ox = S::mul(ox, inv); oy = S::mul(oy, inv); oz = S::mul(oz, inv);
+        }
+        S::template store<A>(outX + i, ox);
+        S::template store<A>(outY + i, oy);
+        S::template store<A>(outZ + i, oz);
+    }
+    soa_scalar(m, x + i, y + i, z + i, count - i, outX + i, outY + i,
+               outZ + i, outW ? outW + i : NULL);
+}
+
+// Vec3 AoS in, vec4 AoS out (Project false) or projected vec3 out.
+template<class S, bool A, bool Project>
+void aos_kernel(const float *m, const float *in, size_t count, float *out)
+{
+    typedef typename S::V V;
+    Matrix<S> mat(m);
+    V one = S::set1(1.0f);
+    size_t i = 0;
+    for (; i + S::W <= count; i += S::W, in += 3 * S::W) {
+        // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+        V a, b, c;
+        S::template load3<A>(in, a, b, c);
+        // xy = x2 y2 x3 y3, yz = y0 z0 y1 z1
+        V xy = S::template shuffle<_MM_SHUFFLE(2, 1, 3, 2)>(b, c);
+        V yz = S::template shuffle<_MM_SHUFFLE(1, 0, 2, 1)>(a, b);
+        V x = S::template shuffle<_MM_SHUFFLE(2, 0, 3, 0)>(a, xy);
+        V y = S::template shuffle<_MM_SHUFFLE(3, 1, 2, 0)>(yz, xy);
+        V z = S::template shuffle<_MM_SHUFFLE(3, 0, 3, 1)>(yz, c);
+
+        V ox, oy, oz, ow;
+        mat.apply(x, y, z, ox, oy, oz, ow);
+        if (Project) {
+            V inv = S::div(one, ow);
+            ox = S::mul(ox, inv); oy = S::mul(oy, inv); oz = S::mul(oz, inv);
+            // xyLo = x0 x1 y0 y1, xyHi = x2 x3 y2 y3, zx = z0 z2 x1 x3,
+            // yzMid = y1 y2 z1 z2, yzEnd = y3 y3 z3 z3
+            V xyLo = S::template shuffle<_MM_SHUFFLE(1, 0, 1, 0)>(ox, oy);
+            V xyHi = S::template shuffle<_MM_SHUFFLE(3, 2, 3, 2)>(ox, oy);
+            V zx = S::template shuffle<_MM_SHUFFLE(3, 1, 2, 0)>(oz, ox);
+            V yzMid = S::template shuffle<_MM_SHUFFLE(2, 1, 2, 1)>(oy, oz);
+            V yzEnd = S::template shuffle<_MM_SHUFFLE(3, 3, 3, 3)>(oy, oz);
+            S::template store3<A>(out,
+                S::template shuffle<_MM_SHUFFLE(2, 0, 2, 0)>(xyLo, zx),
+                S::template shuffle<_MM_SHUFFLE(2, 0, 2, 0)>(yzMid, xyHi),
+                S::template shuffle<_MM_SHUFFLE(2, 0, 3, 1)>(zx, yzEnd));
+            out += 3 * S::W;
+        } else {
+            V t0 = S::unpacklo(ox, oy), t1 = S::unpacklo(oz, ow);
+            V t2 = S::unpackhi(ox, oy), t3 = S::unpackhi(oz, ow);
+            S::template store4<A>(out,
+                S::template shuffle<_MM_SHUFFLE(1, 0, 1, 0)>(t0, t1),
+                S::template shuffle<_MM_SHUFFLE(3, 2, 3, 2)>(t0, t1),
+                S::template shuffle<_MM_SHUFFLE(1, 0, 1, 0)>(t2, t3),
+                S::template shuffle<_MM_SHUFFLE(3, 2, 3, 2)>(t2, t3));
+            out += 4 * S::W;
+        }
+    }
+    if (Project)
+        aos3_scalar(m, in, count - i, out);
+    else
+        aos4_scalar(m, in, count - i, out);
+}
+
+#endif // BATCH_TRANSFORM_SSE2
+
+} // namespace
+
+// Entry points for one instruction set, named batch_<form>_<name>; the
+// aligned flag picks the kernel variant.
+#define BATCH_ENTRY_POINTS(S, name)                                            \
+    void batch_soa_##name(const float *m, const float *x, const float *y,      \
+                          const float *z, size_t count, float *outX,           \
+                          float *outY, float *outZ, float *outW, bool aligned) \
+    {                                                                          \
+        if (aligned)                                                           \
+            soa_kernel<S, true>(m, x, y, z, count, outX, outY, outZ, outW);    \
+        else                                                                   \
+            soa_kernel<S, false>(m, x, y, z, count, outX, outY, outZ, outW);   \
+    }                                                                          \
+    void batch_aos4_##name(const float *m, const float *in, size_t count,     \
+                           float *out, bool aligned)                           \
+    {                                                                          \
+        if (aligned)                                                           \
+            aos_kernel<S, true, false>(m, in, count, out);                     \
+        else                                                                   \
+            aos_kernel<S, false, false>(m, in, count, out);                    \
+    }                                                                          \
+    void batch_aos3_##name(const float *m, const float *in, size_t count,     \
+                           float *out, bool aligned)                           \
+    {                                                                          \
+        if (aligned)                                                           \
+            aos_kernel<S, true, true>(m, in, count, out);                      \
+        else                                                                   \
+            aos_kernel<S, false, true>(m, in, count, out);                     \
+    }
+
+#define BATCH_DECLARE_ENTRY_POINTS(name)                                       \
+    void batch_soa_##name(const float *m, const float *x, const float *y,      \
+                          const float *z, size_t count, float *outX,           \
+                          float *outY, float *outZ, float *outW,               \
+                          bool aligned);                                       \
+    void batch_aos4_##name(const float *m, const float *in, size_t count,     \
+                           float *out, bool aligned);                          \
+    void batch_aos3_##name(const float *m, const float *in, size_t count,     \
+                           float *out, bool aligned);
+
+// Built from batch_transform_avx2.cpp and batch_transform_avx512.cpp, which
+// CMake compiles with their instruction sets enabled on x86 targets.
+#ifdef BATCH_TRANSFORM_AVX
+BATCH_DECLARE_ENTRY_POINTS(avx2)
+BATCH_DECLARE_ENTRY_POINTS(avx512)
+#endif
+
+#endif // BATCH_TRANSFORM_KERNELS_HPP
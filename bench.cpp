@@ -0,0 +1,90 @@
+/*===================================================
+// Benchmark statistics and JSON reporting
+//===================================================*/
+
+#include "bench.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+static double nearest_rank(const vector<double> &sorted, double percentile)
+{
+    size_t rank = static_cast<size_t>(ceil(percentile / 100.0 * sorted.size()));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+FrameTimeStats summarize_frame_times(vector<double> times)
+{
+    FrameTimeStats stats = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (times.empty())
+        return stats;
+    sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double t : times)
+        sum += t;
+    stats.min = 1000.0 * times.front();
+    stats.median = 1000.0 * nearest_rank(times, 50.0);
+    stats.p95 = 1000.0 * nearest_rank(times, 95.0);
+    stats.p99 = 1000.0 * nearest_rank(times, 99.0);
+    stats.mean = 1000.0 * sum / times.size();
+    return stats;
+}
+
+static string json_string(const string &s)
+{
+    ostringstream out;
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+static string json_number(double value)
+{
+    if (!std::isfinite(value))
+        return "null";
+    ostringstream out;
+    out.precision(6);
+    out << value;
+    return out.str();
+}
+
+void BenchReport::set(const string &key, const string &value)
+{
+    fields.push_back(make_pair(key, json_string(value)));
+}
+
+void BenchReport::set(const string &key, double value)
+{
+    fields.push_back(make_pair(key, json_number(value)));
+}
+
+void BenchReport::set(const string &key, const FrameTimeStats &stats)
+{
+    ostringstream out;
+    out << "{ \"min\": " << json_number(stats.min)
+        << ", \"median\": " << json_number(stats.median)
+        << ", \"p95\": " << json_number(stats.p95)
+        << ", \"p99\": " << json_number(stats.p99)
+        << ", \"mean\": " << json_number(stats.mean) << " }";
+    fields.push_back(make_pair(key, out.str()));
+}
+
+void BenchReport::write(ostream &out) const
+{
+    out << "{" << endl;
+    for (size_t i = 0; i < fields.size(); i++) {
+        out << "  " << json_string(fields[i].first) << ": " << fields[i].second
+            << (i + 1 < fields.size() ? "," : "") << endl;
+    }
+    out << "}" << endl;
+}
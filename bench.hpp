@@ -0,0 +1,39 @@
+/*===================================================
+// Benchmark statistics and JSON reporting
+//===================================================*/
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Order statistics of a set of frame times, all in milliseconds.
+struct FrameTimeStats {
+    double min;
+    double median;
+    double p95;
+    double p99;
+    double mean;
+};
+
+// Nearest-rank percentiles; times are in seconds.
+FrameTimeStats summarize_frame_times(std::vector<double> times);
+
+// Flat JSON object of string and numeric fields, written in insertion order
+// so successive runs diff cleanly.
+class BenchReport {
+public:
+    void set(const std::string &key, const std::string &value);
+    void set(const std::string &key, double value);
+    void set(const std::string &key, const FrameTimeStats &stats);
+    void write(std::ostream &out) const;
+
+private:
+    // each value is already JSON-encoded
+    std::vector<std::pair<std::string, std::string> > fields;
+};
+
+#endif // BENCH_HPP
@@ -0,0 +1,181 @@
+/*===================================================
+// RGBA to planar YUV conversion for video output
+//===================================================*/
+
+#include "color_convert.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLOR_CONVERT_SSE2 1
+#include <emmintrin.h>
+#else
+#define COLOR_CONVERT_SSE2 0
+#endif
+
+// BT.601 limited range in 8.8 fixed point. The SSE2 path computes exactly
+// the same integers as the scalar one, 16 pixels of a row pair at a time:
+// channels are split into 16-bit lanes, luma sums fit unsigned 16 bits and
+// chroma from 0-255 averages fits signed 16 bits.
+
+namespace {
+
+inline uint8_t luma(int r, int g, int b)
+{
+    return uint8_t(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t chroma_u(int r, int g, int b)
+{
+    return uint8_t(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uint8_t chroma_v(int r, int g, int b)
+{
+    return uint8_t(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Columns [x, width) of a row pair; bot may equal top for an odd last row
+// and outBot is NULL then.
+void convert_pair_scalar(const uint8_t *top, const uint8_t *bot, int x,
+                         int width, uint8_t *outTop, uint8_t *outBot,
+                         uint8_t *u, uint8_t *v)
+{
+    for (int i = x; i < width; i++) {
+        const uint8_t *t = top + 4 * i, *b = bot + 4 * i;
+        outTop[i] = luma(t[0], t[1], t[2]);
+        if (outBot)
+            outBot[i] = luma(b[0], b[1], b[2]);
+    }
+    for (int i = x; i < width; i += 2) {
+        // an odd last column counts twice, like the last row
+        int j = i + 1 < width ? i + 1 : i;
+        int sum[3];
+        for (int c = 0; c < 3; c++)
+            sum[c] = top[4 * i + c] + top[4 * j + c] +
+                     bot[4 * i + c] + bot[4 * j + c];
+        int r = (sum[0] + 2) >> 2, g = (sum[1] + 2) >> 2, b = (sum[2] + 2) >> 2;
+        u[i / 2] = chroma_u(r, g, b);
+        v[i / 2] = chroma_v(r, g, b);
+    }
+}
+
+#if COLOR_CONVERT_SSE2
+
+// One channel of eight RGBA pixels as 16-bit lanes.
+inline __m128i channel(__m128i a, __m128i b, int shift)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    return _mm_packs_epi32(
+        _mm_and_si128(_mm_srl_epi32(a, _mm_cvtsi32_si128(shift)), mask),
+        _mm_and_si128(_mm_srl_epi32(b, _mm_cvtsi32_si128(shift)), mask));
+}
+
+inline __m128i luma8(__m128i r, __m128i g, __m128i b)
+{
+    __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                      _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+        _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)),
+                      _mm_set1_epi16(128)));
+    return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+inline __m128i chroma8(__m128i r, __m128i g, __m128i b, short cr, short cg,
+                       short cb)
+{
+    __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+                      _mm_mullo_epi16(g, _mm_set1_epi16(cg))),
+        _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cb)),
+                      _mm_set1_epi16(128)));
+    return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+// Sums horizontal pairs of two rows' 16 samples into 8 lanes, then
+// rounds to the average.
+inline __m128i average2x2(__m128i topLo, __m128i topHi, __m128i botLo,
+                          __m128i botHi)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i lo = _mm_madd_epi16(_mm_add_epi16(topLo, botLo), one);
+    __m128i hi = _mm_madd_epi16(_mm_add_epi16(topHi, botHi), one);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(lo, hi),
+                                        _mm_set1_epi16(2)), 2);
+}
+
+struct Rgb16 {
+    __m128i r[2], g[2], b[2]; // pixels 0-7 and 8-15
+};
+
+inline Rgb16 load16(const uint8_t *p)
+{
+    const __m128i *q = reinterpret_cast<const __m128i*>(p);
+    __m128i q0 = _mm_loadu_si128(q), q1 = _mm_loadu_si128(q + 1);
+    __m128i q2 = _mm_loadu_si128(q + 2), q3 = _mm_loadu_si128(q + 3);
+    Rgb16 c;
+    c.r[0] = channel(q0, q1, 0);  c.r[1] = channel(q2, q3, 0);
+    c.g[0] = channel(q0, q1, 8);  c.g[1] = channel(q2, q3, 8);
+    c.b[0] = channel(q0, q1, 16); c.b[1] = channel(q2, q3, 16);
+    return c;
+}
+
+inline void store_luma16(uint8_t *out, const Rgb16 &c)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_packus_epi16(luma8(c.r[0], c.g[0], c.b[0]),
+                                      luma8(c.r[1], c.g[1], c.b[1])));
+}
+
+// Returns the first column left for the scalar code.
+int convert_pair_sse2(const uint8_t *top, const uint8_t *bot, int width,
+                      uint8_t *outTop, uint8_t *outBot, uint8_t *u,
+                      uint8_t *v)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        Rgb16 t = load16(top + 4 * x), b = load16(bot + 4 * x);
+        store_luma16(outTop + x, t);
+        if (outBot)
+            store_luma16(outBot + x, b);
+        __m128i r = average2x2(t.r[0], t.r[1], b.r[0], b.r[1]);
+        __m128i g = average2x2(t.g[0], t.g[1], b.g[0], b.g[1]);
+        __m128i bl = average2x2(t.b[0], t.b[1], b.b[0], b.b[1]);
+        __m128i cu = chroma8(r, g, bl, -38, -74, 112);
+        __m128i cv = chroma8(r, g, bl, 112, -94, -18);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2),
+                         _mm_packus_epi16(cu, cu));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2),
+                         _mm_packus_epi16(cv, cv));
+    }
+    return x;
+}
+
+#endif // COLOR_CONVERT_SSE2
+
+} // namespace
+
+void rgba_to_yuv420(const uint8_t *rgba, ptrdiff_t stride, int width,
+                    int height, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+    const int chromaWidth = (width + 1) / 2;
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t *top = rgba + stride * row;
+        bool pair = row + 1 < height;
+        const uint8_t *bot = pair ? top + stride : top;
+        uint8_t *outTop = y + size_t(width) * row;
+        uint8_t *outBot = pair ? outTop + width : NULL;
+        uint8_t *outU = u + size_t(chromaWidth) * (row / 2);
+        uint8_t *outV = v + size_t(chromaWidth) * (row / 2);
+        int x = 0;
+#if COLOR_CONVERT_SSE2
+        x = convert_pair_sse2(top, bot, width, outTop, outBot, outU, outV);
+#endif
+        convert_pair_scalar(top, bot, x, width, outTop, outBot, outU, outV);
+    }
+}
+
+size_t yuv420_size(int width, int height)
+{
+    size_t chroma = size_t((width + 1) / 2) * size_t((height + 1) / 2);
+    return size_t(width) * height + 2 * chroma;
+}
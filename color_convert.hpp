@@ -0,0 +1,25 @@
+/*===================================================
+// RGBA to planar YUV conversion for video output
+//===================================================*/
+
+#ifndef COLOR_CONVERT_HPP
+#define COLOR_CONVERT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Converts RGBA8 pixels to 8-bit 4:2:0 YCbCr with BT.601 limited-range
+// coefficients, the layout a Y4M "C420jpeg" stream carries. Each chroma
+// sample averages a 2x2 block; an odd last row or column averages what
+// there is. rgba points at the top row and stride is the signed byte
+// distance to the next row down, so bottom-up GL readbacks pass their last
+// row and a negative stride. The planes are packed: y is width x height,
+// u and v are each (width + 1) / 2 x (height + 1) / 2. Uses SSE2 where the
+// compiler targets it.
+void rgba_to_yuv420(const uint8_t *rgba, ptrdiff_t stride, int width,
+                    int height, uint8_t *y, uint8_t *u, uint8_t *v);
+
+// Bytes needed for the three planes of a width x height picture.
+size_t yuv420_size(int width, int height);
+
+#endif // COLOR_CONVERT_HPP
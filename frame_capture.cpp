@@ -0,0 +1,348 @@
+/*===================================================
+// Asynchronous frame capture to PNG files or a video stream
+//===================================================*/
+
+#include "frame_capture.hpp"
+#include "color_convert.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+FrameEncoder::FrameEncoder()
+    : format(CAPTURE_PNG), stream(NULL), fps(0), streamWidth(0),
+      streamHeight(0), streamBroken(false), started(false), quit(false),
+      nextNumber(0), encoding(0), written(0), failed(0), stalled(0.0)
+{
+}
+
+bool FrameEncoder::start(const string &pattern, int threads, int maxQueued)
+{
+    format = CAPTURE_PNG;
+    this->pattern = pattern;
+    if (threads <= 0)
+        threads = std::max(1, ThreadPool::hardwareThreads() - 1);
+    return launch(threads, maxQueued);
+}
+
+bool FrameEncoder::startStream(FILE *out, CaptureFormat format, int fps,
+                               int maxQueued)
+{
+    this->format = format;
+    stream = out;
+    this->fps = fps;
+    // a few frames of slack between the renderer and the output
+    return launch(1, maxQueued > 0 ? maxQueued : 3);
+}
+
+bool FrameEncoder::launch(int threads, int maxQueued)
+{
+    if (maxQueued <= 0)
+        maxQueued = 2 * threads;
+    frames.resize(maxQueued);
+    for (CaptureFrame &f : frames)
+        unused.push_back(&f);
+
+    mtx_init(&lock, mtx_plain);
+    cnd_init(&work);
+    cnd_init(&released);
+    started = true;
+    for (int i = 0; i < threads; i++) {
+        thrd_t t;
+        if (thrd_create(&t, workerMain, this) != thrd_success)
+            break;
+        workers.push_back(t);
+    }
+    return active();
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    if (!started)
+        return;
+    finish();
+    mtx_lock(&lock);
+    quit = true;
+    cnd_broadcast(&work);
+    mtx_unlock(&lock);
+    for (thrd_t t : workers)
+        thrd_join(t, NULL);
+    cnd_destroy(&released);
+    cnd_destroy(&work);
+    mtx_destroy(&lock);
+}
+
+CaptureFrame* FrameEncoder::acquire(int width, int height)
+{
+    mtx_lock(&lock);
+    if (unused.empty()) {
+        Clock::time_point start = Clock::now();
+        while (unused.empty())
+            cnd_wait(&released, &lock);
+        stalled += seconds_since(start);
+    }
+    CaptureFrame *frame = unused.back();
+    unused.pop_back();
+    mtx_unlock(&lock);
+
+    frame->width = width;
+    frame->height = height;
+    frame->stride = size_t(width) * 4;
+    frame->pixels.resize(frame->stride * height); // keeps its capacity
+    return frame;
+}
+
+void FrameEncoder::submit(CaptureFrame *frame)
+{
+    mtx_lock(&lock);
+    if (nextNumber == 0)
+        firstSubmit = Clock::now();
+    frame->number = nextNumber++;
+    if (workers.empty()) {
+        // no threads could be started; drop the frame rather than hang
+        failed++;
+        unused.push_back(frame);
+    } else {
+        queued.push_back(frame);
+        cnd_signal(&work);
+    }
+    mtx_unlock(&lock);
+}
+
+void FrameEncoder::discard(CaptureFrame *frame)
+{
+    mtx_lock(&lock);
+    nextNumber++; // keep the numbers matching the frames
+    failed++;
+    unused.push_back(frame);
+    cnd_broadcast(&released);
+    mtx_unlock(&lock);
+}
+
+void FrameEncoder::finish()
+{
+    mtx_lock(&lock);
+    while (!queued.empty() || encoding > 0)
+        cnd_wait(&released, &lock);
+    mtx_unlock(&lock);
+}
+
+size_t FrameEncoder::framesWritten()
+{
+    mtx_lock(&lock);
+    size_t n = written;
+    mtx_unlock(&lock);
+    return n;
+}
+
+size_t FrameEncoder::failures()
+{
+    mtx_lock(&lock);
+    size_t n = failed;
+    mtx_unlock(&lock);
+    return n;
+}
+
+double FrameEncoder::busySeconds()
+{
+    mtx_lock(&lock);
+    double s = written ? chrono::duration<double>(lastWritten -
+                                                  firstSubmit).count() : 0.0;
+    mtx_unlock(&lock);
+    return s;
+}
+
+int FrameEncoder::workerMain(void *arg)
+{
+    FrameEncoder *self = static_cast<FrameEncoder*>(arg);
+    vector<char> path(self->pattern.size() + 32);
+    mtx_lock(&self->lock);
+    for (;;) {
+        while (self->queued.empty() && !self->quit)
+            cnd_wait(&self->work, &self->lock);
+        if (self->queued.empty())
+            break;
+        CaptureFrame *frame = self->queued.front();
+        self->queued.pop_front();
+        self->encoding++;
+        mtx_unlock(&self->lock);
+
+        bool ok = self->stream ? self->writeStream(*frame) :
+                                 self->writePng(*frame, path);
+
+        mtx_lock(&self->lock);
+        self->encoding--;
+        if (ok) {
+            self->written++;
+            self->lastWritten = Clock::now();
+        } else
+            self->failed++;
+        self->unused.push_back(frame);
+        cnd_broadcast(&self->released);
+    }
+    mtx_unlock(&self->lock);
+    return 0;
+}
+
+bool FrameEncoder::writePng(const CaptureFrame &frame, vector<char> &path)
+{
+    snprintf(path.data(), path.size(), pattern.c_str(), frame.number);
+    // a negative stride writes the bottom-up rows upright
+    const uint8_t *top = frame.pixels.data() + frame.stride * (frame.height - 1);
+    return stbi_write_png(path.data(), frame.width, frame.height, 4, top,
+                          -static_cast<int>(frame.stride)) != 0;
+}
+
+// Only the one stream thread gets here, so the stream state needs no lock.
+bool FrameEncoder::writeStream(const CaptureFrame &frame)
+{
+    if (streamBroken)
+        return false;
+    if (streamWidth == 0) {
+        streamWidth = frame.width;
+        streamHeight = frame.height;
+        if (format == CAPTURE_Y4M) {
+            converted.resize(yuv420_size(streamWidth, streamHeight));
+            // C420jpeg: chroma sited between the four luma samples
+            if (fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                        streamWidth, streamHeight, fps) < 0)
+                streamBroken = true;
+        }
+    }
+    if (frame.width != streamWidth || frame.height != streamHeight)
+        return false;
+
+    const uint8_t *top = frame.pixels.data() + frame.stride * (frame.height - 1);
+    const ptrdiff_t down = -static_cast<ptrdiff_t>(frame.stride);
+    if (format == CAPTURE_Y4M) {
+        uint8_t *y = converted.data();
+        uint8_t *u = y + size_t(streamWidth) * streamHeight;
+        uint8_t *v = u + size_t((streamWidth + 1) / 2) * ((streamHeight + 1) / 2);
+        rgba_to_yuv420(top, down, streamWidth, streamHeight, y, u, v);
+        if (fputs("FRAME\n", stream) < 0 ||
+            fwrite(converted.data(), 1, converted.size(), stream) !=
+                converted.size())
+            streamBroken = true;
+    } else {
+        size_t row = size_t(streamWidth) * 4;
+        for (int i = 0; i < streamHeight && !streamBroken; i++)
+            if (fwrite(top + down * i, 1, row, stream) != row)
+                streamBroken = true;
+    }
+    // hand each frame to the reader as soon as it is complete
+    if (fflush(stream) != 0)
+        streamBroken = true;
+    return !streamBroken;
+}
+
+PboReadback::PboReadback()
+    : encoder(NULL), head(0), pending(0), waited(0.0)
+{
+}
+
+void PboReadback::init(FrameEncoder *encoder, int depth)
+{
+    this->encoder = encoder;
+    ring.resize(std::max(depth, 1));
+    for (Slot &s : ring) {
+        glGenBuffers(1, &s.buffer);
+        s.size = 0;
+        s.fence = NULL;
+        s.width = s.height = 0;
+    }
+}
+
+void PboReadback::destroy()
+{
+    for (Slot &s : ring) {
+        if (s.fence)
+            glDeleteSync(s.fence);
+        glDeleteBuffers(1, &s.buffer);
+    }
+    ring.clear();
+    head = pending = 0;
+}
+
+void PboReadback::capture(int width, int height)
+{
+    // take whatever has already arrived, then make room if still full
+    while (pending > 0 && retire(false))
+        ;
+    if (pending == ring.size())
+        retire(true);
+
+    Slot &s = ring[head];
+    GLsizeiptr size = GLsizeiptr(width) * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    if (s.size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        s.size = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.width = width;
+    s.height = height;
+    head = (head + 1) % ring.size();
+    pending++;
+}
+
+void PboReadback::finish()
+{
+    while (pending > 0)
+        retire(true);
+}
+
+// Copies the oldest frame in flight to the encoder if its fence has
+// signaled, or after waiting for it when wait is set. Returns false if it
+// was not ready.
+bool PboReadback::retire(bool wait)
+{
+    Slot &s = ring[(head + ring.size() - pending) % ring.size()];
+    GLenum status = glClientWaitSync(s.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        if (!wait)
+            return false;
+        Clock::time_point start = Clock::now();
+        do {
+            status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      1000000000); // 1 s, then ask again
+        } while (status == GL_TIMEOUT_EXPIRED);
+        waited += seconds_since(start);
+    }
+    glDeleteSync(s.fence);
+    s.fence = NULL;
+    pending--;
+    if (status == GL_WAIT_FAILED) {
+        // the frame is lost, but the slot is free again
+        encoder->discard(encoder->acquire(s.width, s.height));
+        return true;
+    }
+
+    CaptureFrame *frame = encoder->acquire(s.width, s.height);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, s.size,
+                                          GL_MAP_READ_BIT);
+    if (pixels) {
+        memcpy(frame->pixels.data(), pixels, frame->pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        encoder->submit(frame);
+    } else {
+        encoder->discard(frame);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
@@ -0,0 +1,151 @@
+/*===================================================
+// Asynchronous frame capture to numbered PNG files
+//===================================================*/
+
+// glReadPixels into client memory waits for the GPU to finish the frame,
+// and encoding a PNG takes longer than a frame. PboReadback instead reads
+// each frame into one of a ring of pixel buffer objects and only maps it
+// once its fence has signaled, a few frames later. FrameEncoder then writes
+// the pixels with stb_image_write on its own threads, or streams them in
+// order as Y4M or raw RGBA video from a single thread. Frame buffers are
+// recycled, so a steady capture does not allocate.
+
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+extern "C" {
+#include <tinycthread.h>
+}
+
+// RGBA8 pixels with rows bottom to top, as glReadPixels returns them.
+struct CaptureFrame {
+    std::vector<uint8_t> pixels;
+    int width, height;
+    size_t stride;      // bytes per row
+    int number;         // set by FrameEncoder::submit()
+};
+
+enum CaptureFormat {
+    CAPTURE_PNG,    // one file per frame
+    CAPTURE_Y4M,    // YUV4MPEG2 stream, 4:2:0 BT.601
+    CAPTURE_RGBA,   // headerless RGBA8 frames, rows top to bottom
+    CAPTURE_UNKNOWN
+};
+
+class FrameEncoder {
+public:
+    FrameEncoder();
+    ~FrameEncoder();    // finish() and stop the threads
+
+    // pattern is a printf format with one int conversion for the frame
+    // number, e.g. "frame%05d.png". threads 0 means one per core but the
+    // caller's; at most maxQueued frames wait to be written (0: 2 each).
+    // Returns false if no encoder thread could be started.
+    bool start(const std::string &pattern, int threads = 0, int maxQueued = 0);
+
+    // Writes every frame to out, which stays open, as format with fps in
+    // the Y4M header. One thread converts and writes, so the order holds.
+    // The first frame fixes the size; frames of any other size, and all
+    // frames after a failed write, count as failures.
+    bool startStream(FILE *out, CaptureFormat format, int fps,
+                     int maxQueued = 0);
+    bool active() const { return !workers.empty(); }
+
+    // A free frame with room for width x height, waiting for an encoder to
+    // release one if they are all queued. Pass it back to submit().
+    CaptureFrame* acquire(int width, int height);
+    void submit(CaptureFrame *frame);
+    void discard(CaptureFrame *frame);  // counted as a failure
+
+    // Waits until every submitted frame has been written.
+    void finish();
+
+    int threads() const { return static_cast<int>(workers.size()); }
+    size_t framesWritten();
+    size_t failures();              // frames that could not be written
+    double stallSeconds() const { return stalled; } // spent in acquire()
+    // From the first submit() until the last frame was written.
+    double busySeconds();
+
+private:
+    FrameEncoder(const FrameEncoder&);
+    FrameEncoder& operator=(const FrameEncoder&);
+
+    static int workerMain(void *arg);
+    bool launch(int threads, int maxQueued);
+    bool writePng(const CaptureFrame &frame, std::vector<char> &path);
+    bool writeStream(const CaptureFrame &frame);
+
+    CaptureFormat format;
+    std::string pattern;
+    FILE *stream;       // output of startStream(), else NULL
+    int fps;
+    int streamWidth, streamHeight;  // 0 until the first streamed frame
+    bool streamBroken;  // a write failed; the rest are dropped
+    std::vector<uint8_t> converted; // the stream thread's YUV planes
+    std::vector<thrd_t> workers;
+    std::vector<CaptureFrame> frames;   // fixed size; never reallocated
+    std::vector<CaptureFrame*> unused;
+    std::deque<CaptureFrame*> queued;
+    bool started;       // lock and the condition variables exist
+    mtx_t lock;
+    cnd_t work;         // a frame was queued, or quit was set
+    cnd_t released;     // a frame went back to unused
+    bool quit;
+    int nextNumber;
+    int encoding;       // frames taken off the queue but not written yet
+    size_t written, failed;
+    double stalled;
+    std::chrono::steady_clock::time_point firstSubmit, lastWritten;
+};
+
+// Reads the current read framebuffer through a ring of pixel buffer
+// objects into a FrameEncoder. Needs GL 3.2 sync objects and a current
+// context from init() to destroy().
+class PboReadback {
+public:
+    PboReadback();
+
+    // Creates depth buffers, so up to depth frames are in flight.
+    void init(FrameEncoder *encoder, int depth = 3);
+    void destroy();     // deletes the buffers; call finish() first
+
+    // Starts reading back width x height at the origin. Frames whose reads
+    // have completed are handed to the encoder; when the ring is full this
+    // waits for the oldest.
+    void capture(int width, int height);
+
+    // Hands every outstanding frame to the encoder.
+    void finish();
+
+    double waitSeconds() const { return waited; } // blocked on fences
+
+private:
+    PboReadback(const PboReadback&);
+    PboReadback& operator=(const PboReadback&);
+
+    struct Slot {
+        GLuint buffer;
+        GLsizeiptr size;
+        GLsync fence;   // NULL when the slot is free
+        int width, height;
+    };
+
+    bool retire(bool wait);
+
+    FrameEncoder *encoder;
+    std::vector<Slot> ring;
+    size_t head;        // next slot to read into
+    size_t pending;     // slots in flight, ending just before head
+    double waited;
+};
+
+#endif // FRAME_CAPTURE_HPP
@@ -0,0 +1,138 @@
+/*===================================================
+// View-frustum culling of many bounded objects
+//===================================================*/
+
+#include "frustum.hpp"
+#include <cfloat>
+#include <glm/simd/platform.h>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+Frustum extract_frustum(const mat4 &clip)
+{
+    // Gribb and Hartmann: each plane is the last row plus or minus another
+    mat4 t = transpose(clip);
+    Frustum f;
+    f.planes[0] = t[3] + t[0];
+    f.planes[1] = t[3] - t[0];
+    f.planes[2] = t[3] + t[1];
+    f.planes[3] = t[3] - t[1];
+    f.planes[4] = t[3] + t[2];
+    f.planes[5] = t[3] - t[2];
+    for (int p = 0; p < 6; p++)
+        f.planes[p] /= length(vec3(f.planes[p]));
+    return f;
+}
+
+void CullBounds::resize(size_t n)
+{
+    count = n;
+    size_t padded = (n + 3) & ~size_t(3);
+    sphereX.resize(padded, 0.0f);
+    sphereY.resize(padded, 0.0f);
+    sphereZ.resize(padded, 0.0f);
+    sphereR.resize(padded, -FLT_MAX); // always entirely behind a plane
+    boxX.resize(padded, 0.0f);
+    boxY.resize(padded, 0.0f);
+    boxZ.resize(padded, 0.0f);
+    extX.resize(padded, 0.0f);
+    extY.resize(padded, 0.0f);
+    extZ.resize(padded, 0.0f);
+    for (size_t i = n; i < padded; i++)
+        sphereR[i] = -FLT_MAX;
+}
+
+void CullBounds::setSphere(size_t i, const vec3 &center, float radius)
+{
+    sphereX[i] = center.x;
+    sphereY[i] = center.y;
+    sphereZ[i] = center.z;
+    sphereR[i] = radius;
+}
+
+void CullBounds::setBox(size_t i, const vec3 &boxMin, const vec3 &boxMax)
+{
+    vec3 c = 0.5f * (boxMin + boxMax), e = 0.5f * (boxMax - boxMin);
+    boxX[i] = c.x;
+    boxY[i] = c.y;
+    boxZ[i] = c.z;
+    extX[i] = e.x;
+    extY[i] = e.y;
+    extZ[i] = e.z;
+}
+
+void CullBounds::setFromUnitSphere(size_t i, const mat4 &model)
+{
+    vec3 c = vec3(model[3]);
+    float r = std::max(length(vec3(model[0])),
+                      std::max(length(vec3(model[1])), length(vec3(model[2]))));
+    setSphere(i, c, r);
+    // the transformed sphere reaches the length of each matrix row along
+    // that axis, which is tighter than the bounding sphere under scaling
+    vec3 e = sqrt(vec3(model[0]) * vec3(model[0]) +
+                  vec3(model[1]) * vec3(model[1]) +
+                  vec3(model[2]) * vec3(model[2]));
+    setBox(i, c - e, c + e);
+}
+
+void CullBounds::cull(const Frustum &frustum, vector<uint32_t> &visible) const
+{
+    visible.clear();
+    const size_t padded = sphereR.size();
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    const glm_vec4 signMask = _mm_set1_ps(-0.0f);
+    for (size_t i = 0; i < padded; i += 4) {
+        glm_vec4 sx = _mm_loadu_ps(&sphereX[i]), sy = _mm_loadu_ps(&sphereY[i]);
+        glm_vec4 sz = _mm_loadu_ps(&sphereZ[i]), sr = _mm_loadu_ps(&sphereR[i]);
+        glm_vec4 bx = _mm_loadu_ps(&boxX[i]), by = _mm_loadu_ps(&boxY[i]);
+        glm_vec4 bz = _mm_loadu_ps(&boxZ[i]);
+        glm_vec4 ex = _mm_loadu_ps(&extX[i]), ey = _mm_loadu_ps(&extY[i]);
+        glm_vec4 ez = _mm_loadu_ps(&extZ[i]);
+        int inside = 0xF;
+        for (int p = 0; p < 6 && inside; p++) {
+            const vec4 &pl = frustum.planes[p];
+            glm_vec4 nx = _mm_set1_ps(pl.x), ny = _mm_set1_ps(pl.y);
+            glm_vec4 nz = _mm_set1_ps(pl.z), d = _mm_set1_ps(pl.w);
+            // signed distance of the sphere center, plus its radius
+            glm_vec4 ds = glm_vec4_add(glm_vec4_add(glm_vec4_mul(nx, sx),
+                                                    glm_vec4_mul(ny, sy)),
+                                       glm_vec4_add(glm_vec4_mul(nz, sz), d));
+            ds = glm_vec4_add(ds, sr);
+            // signed distance of the box corner furthest along the normal
+            glm_vec4 db = glm_vec4_add(glm_vec4_add(glm_vec4_mul(nx, bx),
+                                                    glm_vec4_mul(ny, by)),
+                                       glm_vec4_add(glm_vec4_mul(nz, bz), d));
+            glm_vec4 r = glm_vec4_add(glm_vec4_add(
+                glm_vec4_mul(_mm_andnot_ps(signMask, nx), ex),
+                glm_vec4_mul(_mm_andnot_ps(signMask, ny), ey)),
+                glm_vec4_mul(_mm_andnot_ps(signMask, nz), ez));
+            db = glm_vec4_add(db, r);
+            glm_vec4 in = _mm_and_ps(_mm_cmpge_ps(ds, _mm_setzero_ps()),
+                                     _mm_cmpge_ps(db, _mm_setzero_ps()));
+            inside &= _mm_movemask_ps(in);
+        }
+        for (int k = 0; k < 4; k++)
+            if (inside & (1 << k))
+                visible.push_back(static_cast<uint32_t>(i + k));
+    }
+#else
+    for (size_t i = 0; i < padded; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const vec4 &pl = frustum.planes[p];
+            float ds = pl.x*sphereX[i] + pl.y*sphereY[i] + pl.z*sphereZ[i] +
+                       pl.w + sphereR[i];
+            float db = pl.x*boxX[i] + pl.y*boxY[i] + pl.z*boxZ[i] + pl.w +
+                       std::abs(pl.x)*extX[i] + std::abs(pl.y)*extY[i] +
+                       std::abs(pl.z)*extZ[i];
+            inside = ds >= 0.0f && db >= 0.0f;
+        }
+        if (inside)
+            visible.push_back(static_cast<uint32_t>(i));
+    }
+#endif
+}
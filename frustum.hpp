@@ -0,0 +1,47 @@
+/*===================================================
+// View-frustum culling of many bounded objects
+//===================================================*/
+
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Six planes with normals pointing inwards: a point p is inside when
+// dot(plane.xyz, p) + plane.w >= 0 for all of them.
+struct Frustum {
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far
+};
+
+// Planes of the clip volume of clip (P * V, or P * V * M for the frustum in
+// M's object space), normalized so plane distances are true distances.
+Frustum extract_frustum(const glm::mat4 &clip);
+
+// Bounding sphere and axis-aligned box per object, stored as one array per
+// coordinate so the culling pass tests four objects per SSE iteration.
+class CullBounds {
+public:
+    void resize(size_t count);
+    size_t size() const { return count; }
+
+    void setSphere(size_t i, const glm::vec3 &center, float radius);
+    void setBox(size_t i, const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+    // Both bounds of the unit sphere at the origin transformed by model.
+    void setFromUnitSphere(size_t i, const glm::mat4 &model);
+
+    // Replaces visible with the indices, in increasing order, of every
+    // object whose sphere and box both reach into the frustum.
+    void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+private:
+    size_t count = 0;
+    // padded to a multiple of four with objects that never pass
+    std::vector<float> sphereX, sphereY, sphereZ, sphereR;
+    std::vector<float> boxX, boxY, boxZ;    // box centers
+    std::vector<float> extX, extY, extZ;    // box half extents
+};
+
+#endif // FRUSTUM_HPP
@@ -0,0 +1,105 @@
+/*===================================================
+// KHR_debug message callback
+//===================================================*/
+
+#include "gl_debug.hpp"
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+struct DebugName {
+    const char *name;
+    GLenum value;
+};
+
+static const DebugName sources[] = {
+    { "all",             GL_DONT_CARE },
+    { "api",             GL_DEBUG_SOURCE_API },
+    { "window-system",   GL_DEBUG_SOURCE_WINDOW_SYSTEM },
+    { "shader-compiler", GL_DEBUG_SOURCE_SHADER_COMPILER },
+    { "third-party",     GL_DEBUG_SOURCE_THIRD_PARTY },
+    { "application",     GL_DEBUG_SOURCE_APPLICATION },
+    { "other",           GL_DEBUG_SOURCE_OTHER }
+};
+
+// ordered from most to least severe
+static const DebugName severities[] = {
+    { "high",         GL_DEBUG_SEVERITY_HIGH },
+    { "medium",       GL_DEBUG_SEVERITY_MEDIUM },
+    { "low",          GL_DEBUG_SEVERITY_LOW },
+    { "notification", GL_DEBUG_SEVERITY_NOTIFICATION }
+};
+
+static const DebugName types[] = {
+    { "error",               GL_DEBUG_TYPE_ERROR },
+    { "deprecated",          GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR },
+    { "undefined behavior",  GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR },
+    { "portability",         GL_DEBUG_TYPE_PORTABILITY },
+    { "performance",         GL_DEBUG_TYPE_PERFORMANCE },
+    { "marker",              GL_DEBUG_TYPE_MARKER },
+    { "push group",          GL_DEBUG_TYPE_PUSH_GROUP },
+    { "pop group",           GL_DEBUG_TYPE_POP_GROUP },
+    { "other",               GL_DEBUG_TYPE_OTHER }
+};
+
+template <size_t N>
+static GLenum lookup(const DebugName (&table)[N], const char *name)
+{
+    for (size_t i = 0; i < N; i++) {
+        if (strcmp(table[i].name, name) == 0)
+            return table[i].value;
+    }
+    return GL_NONE;
+}
+
+template <size_t N>
+static const char* name_of(const DebugName (&table)[N], GLenum value)
+{
+    for (size_t i = 0; i < N; i++) {
+        if (table[i].value == value)
+            return table[i].name;
+    }
+    return "unknown";
+}
+
+GLenum parse_debug_source(const char *name)
+{
+    return lookup(sources, name);
+}
+
+GLenum parse_debug_severity(const char *name)
+{
+    return lookup(severities, name);
+}
+
+static void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id,
+                                   GLenum severity, GLsizei length,
+                                   const GLchar* message, const void* userParam)
+{
+    cerr << "GL debug [" << name_of(sources, source) << ", "
+         << name_of(types, type) << ", " << name_of(severities, severity)
+         << ", id " << id << "]: " << message << endl;
+}
+
+bool install_gl_debug_output(GLenum source, GLenum minSeverity,
+                             bool synchronous)
+{
+    if (!GLAD_GL_KHR_debug)
+        return false;
+
+    glEnable(GL_DEBUG_OUTPUT);
+    if (synchronous)
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(debugCallback, NULL);
+
+    // start from nothing, then enable each wanted severity for the source
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE,
+                          0, NULL, GL_FALSE);
+    for (const DebugName &s : severities) {
+        glDebugMessageControl(source, GL_DONT_CARE, s.value, 0, NULL, GL_TRUE);
+        if (s.value == minSeverity)
+            break;
+    }
+    return true;
+}
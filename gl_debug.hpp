@@ -0,0 +1,22 @@
+/*===================================================
+// KHR_debug message callback
+//===================================================*/
+
+#ifndef GL_DEBUG_HPP
+#define GL_DEBUG_HPP
+
+#include <glad/glad.h>
+
+// Maps a command-line name to GL_DEBUG_SOURCE_* (GL_DONT_CARE for "all")
+// or GL_DEBUG_SEVERITY_*. Both return GL_NONE for unknown names.
+GLenum parse_debug_source(const char *name);
+GLenum parse_debug_severity(const char *name);
+
+// Routes KHR_debug messages from source (or every source for GL_DONT_CARE)
+// at minSeverity or above to stderr. Messages arrive asynchronously unless
+// synchronous is set, which costs throughput but puts the offending call on
+// the stack in a debugger. Returns false when the context lacks KHR_debug.
+bool install_gl_debug_output(GLenum source, GLenum minSeverity,
+                             bool synchronous);
+
+#endif // GL_DEBUG_HPP
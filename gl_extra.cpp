@@ -0,0 +1,75 @@
+/*===================================================
+// OpenGL entry points beyond the vendored glad loader
+//===================================================*/
+
+#include "gl_extra.hpp"
+#include <GLFW/glfw3.h>
+
+PFNGLVERTEXATTRIBDIVISORPROC glextra_glVertexAttribDivisor = NULL;
+PFNGLQUERYCOUNTERPROC glextra_glQueryCounter = NULL;
+PFNGLGETQUERYOBJECTUI64VPROC glextra_glGetQueryObjectui64v = NULL;
+PFNGLGETPROGRAMBINARYPROC glextra_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glextra_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glextra_glProgramParameteri = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glextra_glMaxShaderCompilerThreadsKHR = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glextra_glMultiDrawElementsIndirect = NULL;
+
+int GLEXTRA_VERSION_3_3 = 0;
+int GLEXTRA_ARB_timer_query = 0;
+int GLEXTRA_ARB_get_program_binary = 0;
+int GLEXTRA_KHR_parallel_shader_compile = 0;
+int GLEXTRA_VERSION_4_3 = 0;
+int GLEXTRA_VERSION_4_6 = 0;
+
+template <typename T>
+static bool load(T &fn, const char *name)
+{
+    fn = reinterpret_cast<T>(glfwGetProcAddress(name));
+    return fn != NULL;
+}
+
+static bool version_at_least(int major, int minor)
+{
+    return GLVersion.major > major ||
+           (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+int load_gl_extra()
+{
+    int missing = 0;
+
+    GLEXTRA_VERSION_3_3 = version_at_least(3, 3) &&
+                          load(glVertexAttribDivisor, "glVertexAttribDivisor");
+    missing += !GLEXTRA_VERSION_3_3;
+
+    // core in 3.3, so only the version or the extension needs checking
+    GLEXTRA_ARB_timer_query = (GLEXTRA_VERSION_3_3 ||
+                               glfwExtensionSupported("GL_ARB_timer_query")) &&
+                              load(glQueryCounter, "glQueryCounter") &&
+                              load(glGetQueryObjectui64v, "glGetQueryObjectui64v");
+    missing += !GLEXTRA_ARB_timer_query;
+
+    GLEXTRA_ARB_get_program_binary = (version_at_least(4, 1) ||
+                                      glfwExtensionSupported("GL_ARB_get_program_binary")) &&
+                                     load(glGetProgramBinary, "glGetProgramBinary") &&
+                                     load(glProgramBinary, "glProgramBinary") &&
+                                     load(glProgramParameteri, "glProgramParameteri");
+    missing += !GLEXTRA_ARB_get_program_binary;
+
+    GLEXTRA_KHR_parallel_shader_compile =
+        (glfwExtensionSupported("GL_KHR_parallel_shader_compile") &&
+         load(glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR")) ||
+        (glfwExtensionSupported("GL_ARB_parallel_shader_compile") &&
+         load(glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsARB"));
+    missing += !GLEXTRA_KHR_parallel_shader_compile;
+
+    GLEXTRA_VERSION_4_3 = version_at_least(4, 3) &&
+                          load(glMultiDrawElementsIndirect,
+                               "glMultiDrawElementsIndirect");
+    missing += !GLEXTRA_VERSION_4_3;
+
+    GLEXTRA_VERSION_4_6 = GLEXTRA_VERSION_4_3 && version_at_least(4, 6);
+    missing += !GLEXTRA_VERSION_4_6;
+
+    return missing;
+}
@@ -0,0 +1,71 @@
+/*===================================================
+// OpenGL entry points beyond the vendored glad loader
+//===================================================*/
+
+// The glad in glfw/deps was generated for GL 3.2 plus a few extensions.
+// Anything newer is declared here in the same style and loaded through
+// GLFW once a context is current.
+
+#ifndef GL_EXTRA_HPP
+#define GL_EXTRA_HPP
+
+#include <glad/glad.h>
+
+// GL 3.3 / ARB_instanced_arrays
+typedef void (APIENTRYP PFNGLVERTEXATTRIBDIVISORPROC)(GLuint index, GLuint divisor);
+extern PFNGLVERTEXATTRIBDIVISORPROC glextra_glVertexAttribDivisor;
+#define glVertexAttribDivisor glextra_glVertexAttribDivisor
+
+// GL 3.3 / ARB_timer_query
+#define GL_TIME_ELAPSED 0x88BF
+#define GL_TIMESTAMP 0x8E28
+typedef void (APIENTRYP PFNGLQUERYCOUNTERPROC)(GLuint id, GLenum target);
+extern PFNGLQUERYCOUNTERPROC glextra_glQueryCounter;
+#define glQueryCounter glextra_glQueryCounter
+typedef void (APIENTRYP PFNGLGETQUERYOBJECTUI64VPROC)(GLuint id, GLenum pname, GLuint64 *params);
+extern PFNGLGETQUERYOBJECTUI64VPROC glextra_glGetQueryObjectui64v;
+#define glGetQueryObjectui64v glextra_glGetQueryObjectui64v
+
+// GL 4.1 / ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+extern PFNGLGETPROGRAMBINARYPROC glextra_glGetProgramBinary;
+#define glGetProgramBinary glextra_glGetProgramBinary
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+extern PFNGLPROGRAMBINARYPROC glextra_glProgramBinary;
+#define glProgramBinary glextra_glProgramBinary
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+extern PFNGLPROGRAMPARAMETERIPROC glextra_glProgramParameteri;
+#define glProgramParameteri glextra_glProgramParameteri
+
+// KHR_parallel_shader_compile (or the ARB variant, which is identical).
+// Only the thread count is set; the link status query after the mesh
+// thread is joined is the one place that waits, so there is nothing to
+// gain from polling GL_COMPLETION_STATUS_KHR.
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glextra_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glextra_glMaxShaderCompilerThreadsKHR
+
+// GL 4.3 / ARB_multi_draw_indirect and ARB_shader_storage_buffer_object
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glextra_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glextra_glMultiDrawElementsIndirect
+
+// Nonzero when the corresponding feature was found by load_gl_extra().
+extern int GLEXTRA_VERSION_3_3;
+extern int GLEXTRA_ARB_timer_query;
+extern int GLEXTRA_ARB_get_program_binary;
+extern int GLEXTRA_KHR_parallel_shader_compile;
+extern int GLEXTRA_VERSION_4_3;
+extern int GLEXTRA_VERSION_4_6; // gl_DrawID in GLSL 4.60; no new entry points
+
+// Loads everything above; call after gladLoadGLLoader() with a current
+// context. Returns the number of features that are missing.
+int load_gl_extra();
+
+#endif // GL_EXTRA_HPP
@@ -180,6 +180,11 @@ int getopt_long(int argc, char* const argv[], const char* optstring,
     if (strncmp(o->name, current_argument, argument_name_length) == 0) {
       match = o;
       ++num_matches;
+      /* An exact match wins over options it is a prefix of, as with GNU. */
+      if (strlen(o->name) == argument_name_length) {
+        num_matches = 1;
+        break;
+      }
     }
   }
 
@@ -0,0 +1,34 @@
+/*===================================================
+// Draw-command lists for multi-draw indirect submission
+//===================================================*/
+
+#include "indirect.hpp"
+
+using namespace std;
+using namespace glm;
+
+void IndirectDrawBuilder::clear()
+{
+    commands.clear();
+    draws.clear();
+    triangleCount = 0.0;
+}
+
+void IndirectDrawBuilder::add(const OctantLod &lod, GLuint instances,
+                              const mat4 &model, const vec3 &color)
+{
+    DrawElementsIndirectCommand cmd;
+    cmd.count = static_cast<GLuint>(lod.indexCount);
+    cmd.instanceCount = instances;
+    cmd.firstIndex = static_cast<GLuint>(lod.firstIndex);
+    cmd.baseVertex = lod.baseVertex;
+    cmd.baseInstance = 0; // per-draw data comes from gl_DrawID instead
+    commands.push_back(cmd);
+
+    IndirectDrawData draw;
+    draw.model = model;
+    draw.color = vec4(color, 1.0f);
+    draws.push_back(draw);
+
+    triangleCount += octant_index_count(lod.level) / 3.0 * instances;
+}
@@ -0,0 +1,52 @@
+/*===================================================
+// Draw-command lists for multi-draw indirect submission
+//===================================================*/
+
+#ifndef INDIRECT_HPP
+#define INDIRECT_HPP
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "octant.hpp"
+
+// Layout fixed by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;   // in indices, not bytes
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// What the vertex shader fetches from the storage buffer with gl_DrawID;
+// std430 layout, so the color is padded to a vec4.
+struct IndirectDrawData {
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// Collects one command per object, each at its own level of detail, with
+// its per-draw data alongside, ready to upload and submit in one call.
+// Storage is kept between frames, so rebuilding does not allocate.
+class IndirectDrawBuilder {
+public:
+    void clear();
+    void add(const OctantLod &lod, GLuint instances, const glm::mat4 &model,
+             const glm::vec3 &color);
+
+    size_t size() const { return commands.size(); }
+    const DrawElementsIndirectCommand* commandData() const
+    { return commands.data(); }
+    const IndirectDrawData* drawData() const { return draws.data(); }
+    // Triangles in all commands, for reporting.
+    double triangles() const { return triangleCount; }
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawData> draws;
+    double triangleCount = 0.0;
+};
+
+#endif // INDIRECT_HPP
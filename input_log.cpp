@@ -0,0 +1,189 @@
+/*===================================================
+// Recording and replaying mouse input by frame
+//===================================================*/
+
+#include "input_log.hpp"
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char logMagic[4] = { 'T', '0', 'I', 'N' };
+const uint32_t logVersion = 1;
+const size_t headerSize = 16;   // magic, version, width, height
+const size_t recordSize = 28;   // frame, time, type, button, action, pad, x, y
+const int maxWindowSize = 16384; // past any viewport a GL driver allows
+
+void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = uint8_t(v >> (8 * i));
+}
+
+void put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = uint8_t(v >> (8 * i));
+}
+
+uint32_t get_u32(const uint8_t *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+uint64_t get_u64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+// Floats travel as their IEEE bits, so replayed positions are exact.
+void put_double(uint8_t *p, double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    put_u64(p, bits);
+}
+
+double get_double(const uint8_t *p)
+{
+    uint64_t bits = get_u64(p);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+} // namespace
+
+InputRecorder::InputRecorder()
+    : file(NULL), frame(0), count(0), failed(false)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+bool InputRecorder::open(const char *path, int width, int height)
+{
+    file = fopen(path, "wb");
+    if (!file)
+        return false;
+    uint8_t header[headerSize];
+    memcpy(header, logMagic, sizeof(logMagic));
+    put_u32(header + 4, logVersion);
+    put_u32(header + 8, uint32_t(width));
+    put_u32(header + 12, uint32_t(height));
+    failed = fwrite(header, 1, headerSize, file) != headerSize;
+    frame = 0;
+    count = 0;
+    start = chrono::steady_clock::now();
+    return !failed;
+}
+
+void InputRecorder::record(InputEventType type, int button, int action,
+                           double x, double y)
+{
+    if (!file)
+        return;
+    float time = chrono::duration<float>(chrono::steady_clock::now() -
+                                         start).count();
+    uint32_t timeBits;
+    memcpy(&timeBits, &time, sizeof(timeBits));
+
+    uint8_t r[recordSize];
+    put_u32(r, frame);
+    put_u32(r + 4, timeBits);
+    r[8] = uint8_t(type);
+    r[9] = uint8_t(button);
+    r[10] = uint8_t(action);
+    r[11] = 0;
+    put_double(r + 12, x);
+    put_double(r + 20, y);
+    if (fwrite(r, 1, recordSize, file) != recordSize)
+        failed = true;
+    count++;
+}
+
+bool InputRecorder::close()
+{
+    if (!file)
+        return !failed;
+    if (fclose(file) != 0)
+        failed = true;
+    file = NULL;
+    return !failed;
+}
+
+InputReplay::InputReplay()
+    : width(0), height(0), cursor(0), loaded(false)
+{
+}
+
+bool InputReplay::load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint8_t header[headerSize];
+    bool ok = fread(header, 1, headerSize, f) == headerSize &&
+              memcmp(header, logMagic, sizeof(logMagic)) == 0 &&
+              get_u32(header + 4) == logVersion;
+    log.clear();
+    uint8_t r[recordSize];
+    size_t got;
+    while (ok && (got = fread(r, 1, recordSize, f)) == recordSize) {
+        InputEvent e;
+        e.frame = get_u32(r);
+        uint32_t timeBits = get_u32(r + 4);
+        memcpy(&e.time, &timeBits, sizeof(e.time));
+        e.type = r[8];
+        e.button = r[9];
+        e.action = r[10];
+        e.x = get_double(r + 12);
+        e.y = get_double(r + 20);
+        // stamps never go backwards in a recording
+        ok = e.type <= INPUT_SCROLL &&
+             (log.empty() || e.frame >= log.back().frame);
+        log.push_back(e);
+    }
+    // a truncated last record means the file is damaged
+    ok = ok && got == 0 && !ferror(f);
+    fclose(f);
+    if (!ok) {
+        log.clear();
+        return false;
+    }
+    // the size opens a window or sizes the software framebuffer as is
+    uint32_t w = get_u32(header + 8), h = get_u32(header + 12);
+    if (w < 1 || h < 1 || w > uint32_t(maxWindowSize) ||
+        h > uint32_t(maxWindowSize)) {
+        log.clear();
+        return false;
+    }
+    width = int(w);
+    height = int(h);
+    cursor = 0;
+    loaded = true;
+    return true;
+}
+
+bool InputReplay::next(uint32_t frame, InputEvent &event)
+{
+    if (cursor == log.size() || log[cursor].frame > frame)
+        return false;
+    event = log[cursor++];
+    return true;
+}
+
+uint32_t InputReplay::frames() const
+{
+    return log.empty() ? 0 : log.back().frame + 1;
+}
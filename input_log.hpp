@@ -0,0 +1,89 @@
+/*===================================================
+// Recording and replaying mouse input by frame
+//===================================================*/
+
+// A log is a header followed by one fixed-size record per event, all
+// little-endian so a log replays the same on any machine. Each event is
+// stamped with the frame whose applyInput() consumed it. A replay feeds
+// each event to the frame with that stamp, whatever the timing, so a run
+// sees the same input at the same frames every time.
+
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+enum InputEventType {
+    INPUT_BUTTON,   // button and action, cursor position in x and y
+    INPUT_CURSOR,   // cursor position in x and y
+    INPUT_SCROLL    // scroll offsets in x and y
+};
+
+struct InputEvent {
+    uint32_t frame;     // applied just before this frame's input
+    float time;         // seconds since recording began; informational
+    uint8_t type;       // InputEventType
+    uint8_t button, action;
+    double x, y;
+};
+
+// Appends events to a file as they arrive. Events recorded before the
+// first nextFrame() belong to frame 0.
+class InputRecorder {
+public:
+    InputRecorder();
+    ~InputRecorder();   // close()
+
+    // width and height are the window size, for the replay.
+    bool open(const char *path, int width, int height);
+    bool active() const { return file != NULL; }
+
+    // Ignored unless active().
+    void record(InputEventType type, int button, int action, double x,
+                double y);
+    void nextFrame() { frame++; } // call after each frame's input is applied
+
+    // Returns false if any write failed.
+    bool close();
+    size_t events() const { return count; }
+
+private:
+    InputRecorder(const InputRecorder&);
+    InputRecorder& operator=(const InputRecorder&);
+
+    FILE *file;
+    uint32_t frame;
+    size_t count;
+    bool failed;
+    std::chrono::steady_clock::time_point start;
+};
+
+// A whole log, read up front.
+class InputReplay {
+public:
+    InputReplay();
+
+    // False if unreadable or malformed, including a window size outside
+    // 1 to 16384 pixels.
+    bool load(const char *path);
+    bool active() const { return loaded; }
+
+    // The next unread event stamped frame or earlier, in recorded order.
+    bool next(uint32_t frame, InputEvent &event);
+
+    // Frames needed to apply every event: the last stamp plus one.
+    uint32_t frames() const;
+    size_t events() const { return log.size(); }
+    int width, height;  // window size when recorded
+
+private:
+    std::vector<InputEvent> log;
+    size_t cursor;
+    bool loaded;
+};
+
+#endif // INPUT_LOG_HPP
@@ -0,0 +1,213 @@
+/*===================================================
+// Index and vertex reordering for post-transform cache and fetch locality
+//===================================================*/
+
+#include "mesh_opt.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+
+using namespace std;
+
+VertexCacheStats analyze_vertex_cache(const GLuint *indices, size_t indexCount,
+                                      size_t vertexCount, int cacheSize)
+{
+    // timestamps instead of an explicit queue: a vertex is cached when it
+    // was pushed within the last cacheSize misses
+    vector<size_t> pushedAt(vertexCount, 0);
+    size_t misses = 0, unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i];
+        if (pushedAt[v] == 0)
+            unique++;
+        if (pushedAt[v] == 0 || misses + 1 - pushedAt[v] > size_t(cacheSize)) {
+            misses++;
+            pushedAt[v] = misses;
+        }
+    }
+    VertexCacheStats stats;
+    stats.acmr = indexCount ? float(misses) / float(indexCount/3) : 0.0f;
+    stats.atvr = unique ? float(misses) / float(unique) : 0.0f;
+    return stats;
+}
+
+namespace {
+
+const int CACHE_SIZE = 32;
+
+float vertex_score(int cachePos, unsigned remaining)
+{
+    static const float CACHE_DECAY_POWER = 1.5f;
+    static const float LAST_TRI_SCORE = 0.75f;
+    static const float VALENCE_BOOST_SCALE = 2.0f;
+    static const float VALENCE_BOOST_POWER = 0.5f;
+
+    if (remaining == 0)
+        return -1.0f; // no triangles left to use this vertex
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) {
+            // used by the last triangle; don't favour it over the rest of
+            // the cache or we get long thin strips
+            score = LAST_TRI_SCORE;
+        }
+        else {
+            const float scaler = 1.0f / (CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePos - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+    // boost vertices with few triangles left so they get finished off
+    score += VALENCE_BOOST_SCALE * powf(float(remaining), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+}
+
+void optimize_vertex_cache(GLuint *indices, size_t indexCount,
+                           size_t vertexCount)
+{
+    const size_t triCount = indexCount / 3;
+    const size_t NONE = size_t(-1);
+    if (triCount == 0)
+        return;
+
+    // per-vertex lists of triangles not yet emitted; the live part of each
+    // list is adj[adjOffset[v] .. adjOffset[v] + remaining[v])
+    vector<unsigned> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
+        remaining[indices[i]]++;
+    vector<size_t> adjOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjOffset[v + 1] = adjOffset[v] + remaining[v];
+    vector<size_t> adj(indexCount);
+    {
+        vector<size_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for (size_t i = 0; i < indexCount; i++)
+            adj[fill[indices[i]]++] = i / 3;
+    }
+
+    vector<int> cachePos(vertexCount, -1);
+    vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vScore[v] = vertex_score(-1, remaining[v]);
+    vector<float> tScore(triCount);
+    size_t bestTri = 0;
+    for (size_t t = 0; t < triCount; t++) {
+        tScore[t] = vScore[indices[3*t]] + vScore[indices[3*t+1]]
+                  + vScore[indices[3*t+2]];
+        if (tScore[t] > tScore[bestTri])
+            bestTri = t;
+    }
+
+    vector<char> emitted(triCount, 0);
+    vector<GLuint> out(indexCount);
+    GLuint cache[CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    for (size_t t = 0; t < triCount; t++) {
+        if (bestTri == NONE) {
+            // nothing in the cache touches a live triangle; restart from
+            // the next unemitted one in input order
+            while (emitted[scanCursor])
+                scanCursor++;
+            bestTri = scanCursor;
+        }
+        emitted[bestTri] = 1;
+        const GLuint *tri = &indices[3*bestTri];
+        out[3*t] = tri[0];
+        out[3*t+1] = tri[1];
+        out[3*t+2] = tri[2];
+
+        for (int k = 0; k < 3; k++) {
+            GLuint v = tri[k];
+            size_t *list = &adj[adjOffset[v]];
+            unsigned last = --remaining[v];
+            for (unsigned a = 0; a <= last; a++) {
+                if (list[a] == bestTri) {
+                    list[a] = list[last];
+                    break;
+                }
+            }
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        GLuint newCache[CACHE_SIZE + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+            newCache[newCount++] = tri[k];
+        for (int c = 0; c < cacheCount; c++) {
+            GLuint v = cache[c];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCount++] = v;
+        }
+        for (int c = 0; c < newCount; c++) {
+            GLuint v = newCache[c];
+            cachePos[v] = c < CACHE_SIZE ? c : -1;
+            vScore[v] = vertex_score(cachePos[v], remaining[v]);
+        }
+
+        // rescore triangles touching anything that moved and pick the best
+        bestTri = NONE;
+        float bestScore = -1.0f;
+        for (int c = 0; c < newCount; c++) {
+            GLuint v = newCache[c];
+            const size_t *list = &adj[adjOffset[v]];
+            for (unsigned a = 0; a < remaining[v]; a++) {
+                size_t u = list[a];
+                tScore[u] = vScore[indices[3*u]] + vScore[indices[3*u+1]]
+                          + vScore[indices[3*u+2]];
+                if (tScore[u] > bestScore) {
+                    bestScore = tScore[u];
+                    bestTri = u;
+                }
+            }
+        }
+
+        cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+        for (int c = 0; c < cacheCount; c++)
+            cache[c] = newCache[c];
+    }
+
+    for (size_t i = 0; i < indexCount; i++)
+        indices[i] = out[i];
+}
+
+vector<GLuint> optimize_vertex_fetch_remap(GLuint *indices, size_t indexCount,
+                                           size_t vertexCount)
+{
+    const GLuint UNUSED = GLuint(-1);
+    vector<GLuint> remap(vertexCount, UNUSED);
+    GLuint next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint &r = remap[indices[i]];
+        if (r == UNUSED)
+            r = next++;
+        indices[i] = r;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == UNUSED)
+            remap[v] = next++;
+    }
+    return remap;
+}
+
+size_t build_edge_list(const GLuint *indices, size_t indexCount,
+                       GLuint *lines)
+{
+    unordered_set<uint64_t> seen;
+    seen.reserve(indexCount);
+    size_t n = 0;
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        for (int k = 0; k < 3; k++) {
+            GLuint a = indices[t + k], b = indices[t + (k + 1) % 3];
+            uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+            if (seen.insert(key).second) {
+                lines[n++] = a;
+                lines[n++] = b;
+            }
+        }
+    }
+    return n;
+}
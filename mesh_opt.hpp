@@ -0,0 +1,53 @@
+/*===================================================
+// Index and vertex reordering for post-transform cache and fetch locality
+//===================================================*/
+
+#ifndef MESH_OPT_HPP
+#define MESH_OPT_HPP
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+
+// Simulated post-transform cache behaviour of an index buffer.
+struct VertexCacheStats {
+    float acmr; // transformed vertices per triangle (0.5 is ideal for grids)
+    float atvr; // transformed vertices per referenced vertex (1.0 is ideal)
+};
+
+// Replays the indices through a FIFO cache of cacheSize entries.
+VertexCacheStats analyze_vertex_cache(const GLuint *indices, size_t indexCount,
+                                      size_t vertexCount, int cacheSize);
+
+// Reorders triangles in place for an LRU post-transform cache using Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring.
+void optimize_vertex_cache(GLuint *indices, size_t indexCount,
+                           size_t vertexCount);
+
+// Renumbers vertices in the order the indices first use them and rewrites
+// the indices to match. Returns remap, where remap[old] is the new position;
+// vertices the indices never touch are moved to the end.
+std::vector<GLuint> optimize_vertex_fetch_remap(GLuint *indices,
+                                                size_t indexCount,
+                                                size_t vertexCount);
+
+// Writes each edge of a triangle list once, as pairs of indices for
+// GL_LINES, in the order the triangles first use them (so the triangles'
+// cache ordering carries over). Returns the number of indices written; lines
+// needs room for two per distinct edge, at most 2*indexCount.
+size_t build_edge_list(const GLuint *indices, size_t indexCount,
+                       GLuint *lines);
+
+// Applies optimize_vertex_fetch_remap() to an array of vertices.
+template <typename V>
+void optimize_vertex_fetch(V *vertices, size_t vertexCount,
+                           GLuint *indices, size_t indexCount)
+{
+    std::vector<GLuint> remap = optimize_vertex_fetch_remap(indices, indexCount,
+                                                            vertexCount);
+    std::vector<V> original(vertices, vertices + vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertices[remap[v]] = original[v];
+}
+
+#endif // MESH_OPT_HPP
@@ -0,0 +1,235 @@
+/*===================================================
+// Octant mesh generation for the unit sphere
+//===================================================*/
+
+#include "octant.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+using namespace std;
+using namespace glm;
+
+// Rows run from the (1,0,0) edge towards the pole at (0,0,1); row r has
+// n+1-r vertices and 2(n-r)-1 triangles, so where a row starts in either
+// array has a closed form and any band of rows can be written on its own.
+static inline size_t row_first_vertex(size_t n, size_t r)
+{
+    return r*(n + 1) - r*(r - 1)/2;
+}
+
+static inline size_t row_first_index(size_t n, size_t r)
+{
+    return 3*(r*(2*n - 1) - r*(r - 1));
+}
+
+void init_octant_rows(int level, int rowBegin, int rowEnd,
+                      Vertex *octant, GLuint *octant_idx)
+{
+    const int n = 1 << level; // edges along each side
+    const float d = 1.0f/n;
+    for (int r = rowBegin; r < rowEnd && r <= n; r++) {
+        // vertices of row r lie on the plane x+y+z = 1; normalizing in the
+        // same pass means each vertex is written exactly once
+        Vertex *v = octant + row_first_vertex(n, r);
+        for (int c = 0; c <= n - r; c++)
+            v[c].position = normalize(vec3(1.0f - (r + c)*d, c*d, r*d));
+        if (r == n)
+            break; // the pole has no triangles of its own
+
+        GLuint ll = static_cast<GLuint>(row_first_vertex(n, r));
+        GLuint *idx = octant_idx + row_first_index(n, r);
+        int j = 0;
+        for (int s=1; s<n-r+1; s++) {
+            idx[j++] = ll + s - 1;
+            idx[j++] = ll + s;
+            idx[j++] = ll + s + n - r;
+        }
+        for (int t=1; t<n-r; t++) {
+            idx[j++] = ll + t;
+            idx[j++] = ll + t + n + 1 - r;
+            idx[j++] = ll + t + n - r;
+        }
+    }
+}
+
+void init_octant(int level, Vertex *octant, GLuint *octant_idx)
+{
+    init_octant_rows(level, 0, (1 << level) + 1, octant, octant_idx);
+}
+
+void init_octant_strip(int level, GLuint *strip_idx)
+{
+    const int n = 1 << level;
+    size_t j = 0;
+    for (int r = 0; r < n; r++) {
+        // zigzag between row r and row r+1, walked from the far end so the
+        // first triangle winds like the list's
+        const int m = n - r; // row r has m+1 vertices, row r+1 has m
+        GLuint lower = static_cast<GLuint>(row_first_vertex(n, r));
+        GLuint upper = lower + m + 1;
+        if (r > 0)
+            strip_idx[j++] = OCTANT_RESTART_INDEX;
+        strip_idx[j++] = lower + m;
+        for (int c = m - 1; c >= 0; c--) {
+            strip_idx[j++] = upper + c;
+            strip_idx[j++] = lower + c;
+        }
+    }
+}
+
+void strip_octant_lods(OctantLodSet &lods)
+{
+    size_t numIdx = 0;
+    for (const OctantLod &lod : lods.lods)
+        numIdx += octant_strip_index_count(lod.level);
+    lods.indices.resize(numIdx);
+    lods.bakedIndices = nullptr;
+    lods.bakedIndexCount = 0;
+
+    size_t e = 0;
+    for (OctantLod &lod : lods.lods) {
+        lod.firstIndex = e;
+        lod.indexCount = static_cast<GLsizei>(octant_strip_index_count(lod.level));
+        init_octant_strip(lod.level, &lods.indices[e]);
+        e += lod.indexCount;
+    }
+    lods.primitive = GL_TRIANGLE_STRIP;
+}
+
+void edge_octant_lods(OctantLodSet &lods)
+{
+    size_t numIdx = 0;
+    for (const OctantLod &lod : lods.lods)
+        numIdx += octant_edge_index_count(lod.level);
+    vector<GLuint> lines(numIdx);
+
+    const GLuint *triangles = lods.indexData();
+    size_t e = 0;
+    for (OctantLod &lod : lods.lods) {
+        size_t count = build_edge_list(triangles + lod.firstIndex,
+                                       lod.indexCount, &lines[e]);
+        lod.firstIndex = e;
+        lod.indexCount = static_cast<GLsizei>(count);
+        e += count;
+    }
+    lods.indices.swap(lines);
+    lods.bakedIndices = nullptr;
+    lods.bakedIndexCount = 0;
+    lods.primitive = GL_LINES;
+}
+
+OctantLodSet build_octant_lods(int minLevel, int maxLevel, ThreadPool *pool)
+{
+    OctantLodSet set;
+    size_t numVerts = 0, numIdx = 0;
+    for (int level = minLevel; level <= maxLevel; level++) {
+        numVerts += octant_vertex_count(level);
+        numIdx += octant_index_count(level);
+    }
+    set.vertices.resize(numVerts);
+    set.indices.resize(numIdx);
+
+    size_t v = 0, e = 0;
+    for (int level = minLevel; level <= maxLevel; level++) {
+        OctantLod lod;
+        lod.level = level;
+        lod.baseVertex = static_cast<GLint>(v);
+        lod.firstIndex = e;
+        lod.indexCount = static_cast<GLsizei>(octant_index_count(level));
+        set.lods.push_back(lod);
+        v += octant_vertex_count(level);
+        e += octant_index_count(level);
+    }
+
+    // Bands of rows, each writing its own disjoint part of the arrays.
+    // Rows shrink towards the pole, so bands are kept small and handed out
+    // dynamically rather than split evenly per thread.
+    for (const OctantLod &lod : set.lods) {
+        Vertex *verts = &set.vertices[lod.baseVertex];
+        GLuint *idx = &set.indices[lod.firstIndex];
+        const int rows = (1 << lod.level) + 1;
+        if (!pool || lod.level < 8) {
+            init_octant_rows(lod.level, 0, rows, verts, idx);
+            continue;
+        }
+        const size_t band = 16;
+        pool->parallelFor(rows, band, [&](size_t begin, size_t end) {
+            init_octant_rows(lod.level, int(begin), int(end), verts, idx);
+        });
+    }
+    return set;
+}
+
+vector<OctantLodCacheStats> optimize_octant_lods(OctantLodSet &lods,
+                                                 int cacheSize,
+                                                 ThreadPool *pool)
+{
+    vector<OctantLodCacheStats> stats(lods.lods.size());
+    // levels are independent, so they are optimized side by side; finest
+    // first so the longest one starts earliest
+    auto optimize = [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            const OctantLod &lod = lods.lods[lods.lods.size() - 1 - k];
+            Vertex *verts = &lods.vertices[lod.baseVertex];
+            GLuint *idx = &lods.indices[lod.firstIndex];
+            size_t numVerts = octant_vertex_count(lod.level);
+            OctantLodCacheStats &s = stats[lods.lods.size() - 1 - k];
+            s.level = lod.level;
+            s.before = analyze_vertex_cache(idx, lod.indexCount, numVerts, cacheSize);
+            optimize_vertex_cache(idx, lod.indexCount, numVerts);
+            optimize_vertex_fetch(verts, numVerts, idx, lod.indexCount);
+            s.after = analyze_vertex_cache(idx, lod.indexCount, numVerts, cacheSize);
+        }
+    };
+    if (pool)
+        pool->parallelFor(lods.lods.size(), 1, optimize);
+    else
+        optimize(0, lods.lods.size());
+    return stats;
+}
+
+CompactOctantLods compact_octant_lods(const OctantLodSet &lods)
+{
+    CompactOctantLods compact;
+    const Vertex *verts = lods.vertexData();
+    compact.vertices.resize(lods.vertexCount());
+    for (size_t i = 0; i < compact.vertices.size(); i++) {
+        GLshort *p = compact.vertices[i].position;
+        for (int k = 0; k < 3; k++)
+            p[k] = static_cast<GLshort>(packSnorm1x16(verts[i].position[k]));
+        p[3] = 0;
+    }
+    if (lods.lods.empty() || lods.lods.back().level > MAX_SHORT_INDEX_LEVEL)
+        return compact;
+
+    const GLuint *idx = lods.indexData();
+    compact.indices.resize(lods.indexCount());
+    for (size_t i = 0; i < compact.indices.size(); i++)
+        compact.indices[i] = idx[i] == OCTANT_RESTART_INDEX ?
+            0xFFFF : static_cast<GLushort>(idx[i]);
+    return compact;
+}
+
+size_t select_octant_lod(const OctantLodSet &lods, const mat4 &MV,
+                         const mat4 &P, int viewportHeight,
+                         float pixelsPerEdge)
+{
+    const size_t finest = lods.lods.size() - 1;
+    vec4 center = MV * vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    float radius = std::max(length(vec3(MV[0])),
+                            std::max(length(vec3(MV[1])), length(vec3(MV[2]))));
+    float dist = -center.z;
+    if (dist <= radius)
+        return finest; // camera is inside or touching the bounding sphere
+
+    // projected radius in pixels, then the length of one edge at level 0
+    float radiusPx = radius * P[1][1] / dist * 0.5f * viewportHeight;
+    float edgePx = radiusPx * half_pi<float>();
+    for (size_t k = 0; k < lods.lods.size(); k++) {
+        if (edgePx / float(1 << lods.lods[k].level) <= pixelsPerEdge)
+            return k;
+    }
+    return finest;
+}
@@ -0,0 +1,162 @@
+/*===================================================
+// Octant mesh generation for the unit sphere
+//===================================================*/
+
+#ifndef OCTANT_HPP
+#define OCTANT_HPP
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "mesh_opt.hpp"
+
+class ThreadPool;
+
+struct Vertex {
+    glm::vec3 position;
+};
+
+// Levels above this overflow 32-bit index counts long before they are useful.
+const int MAX_OCTANT_LEVEL = 14;
+
+// A level L octant has 2^L edges along each side of the spherical triangle.
+inline size_t octant_vertex_count(int level)
+{
+    size_t n = size_t(1) << level;
+    return (n + 1) * (n + 2) / 2;
+}
+
+inline size_t octant_index_count(int level)
+{
+    size_t n = size_t(1) << level;
+    return n * n * 3;
+}
+
+// Writes the level's vertices and triangle indices into caller-provided
+// storage of octant_vertex_count(level) and octant_index_count(level)
+// elements. Indices are relative to the first vertex of this level.
+void init_octant(int level, Vertex *octant, GLuint *octant_idx);
+
+// Writes only vertex rows [rowBegin, rowEnd) of a level (row 0 holds the
+// 2^level+1 vertices of the y = 0 edge, row 2^level is the pole) and the
+// triangles between each of those rows and the next. Disjoint bands touch
+// disjoint parts of both arrays, so they can be filled concurrently.
+void init_octant_rows(int level, int rowBegin, int rowEnd,
+                      Vertex *octant, GLuint *octant_idx);
+
+// Same level as one triangle strip per row, rows separated by
+// OCTANT_RESTART_INDEX: n^2 + 3n - 1 indices instead of 3n^2.
+const GLuint OCTANT_RESTART_INDEX = 0xFFFFFFFF;
+
+inline size_t octant_strip_index_count(int level)
+{
+    size_t n = size_t(1) << level;
+    return n * n + 3 * n - 1;
+}
+
+// Writes octant_strip_index_count(level) strip indices for the vertices
+// init_octant() writes, with the same winding as its triangle list.
+void init_octant_strip(int level, GLuint *strip_idx);
+
+// One tessellation level within a shared vertex/index buffer pair.
+struct OctantLod {
+    int level;
+    GLint baseVertex;     // first vertex of this level in the VBO
+    size_t firstIndex;    // first index of this level in the EBO
+    GLsizei indexCount;
+};
+
+// Several tessellation levels packed back to back, ready for one VBO/EBO.
+// The arrays either live in the vectors or, for levels compiled into the
+// binary (octant_baked.hpp), in read-only data; use the accessors below
+// when uploading.
+struct OctantLodSet {
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<OctantLod> lods; // ordered by increasing level
+    // GL_TRIANGLES, GL_TRIANGLE_STRIP with OCTANT_RESTART_INDEX between
+    // rows, or GL_LINES for the edge lists
+    GLenum primitive = GL_TRIANGLES;
+
+    const Vertex *bakedVertices = nullptr;
+    const GLuint *bakedIndices = nullptr;
+    size_t bakedVertexCount = 0;
+    size_t bakedIndexCount = 0;
+
+    bool baked() const { return bakedVertices != nullptr; }
+    const Vertex* vertexData() const
+    { return baked() ? bakedVertices : vertices.data(); }
+    size_t vertexCount() const
+    { return baked() ? bakedVertexCount : vertices.size(); }
+    const GLuint* indexData() const
+    { return bakedIndices ? bakedIndices : indices.data(); }
+    size_t indexCount() const
+    { return bakedIndices ? bakedIndexCount : indices.size(); }
+};
+
+// Compact upload format: positions on the unit sphere as 16-bit snorm
+// (the GL normalizes them back to [-1, 1], and they double as normals), with
+// the fourth component only padding each vertex to a 4-byte aligned 8 bytes.
+struct CompactVertex {
+    GLshort position[4];
+};
+
+// Levels whose vertex count fits 16-bit indices; each level's indices are
+// relative to its own baseVertex, so only the largest level matters.
+const int MAX_SHORT_INDEX_LEVEL = 8;
+
+// An OctantLodSet repacked for upload, sharing its lods. indices stays empty
+// when the finest level needs 32-bit indices; use the set's own then. Strip
+// restarts become 0xFFFF.
+struct CompactOctantLods {
+    std::vector<CompactVertex> vertices;
+    std::vector<GLushort> indices;
+};
+
+// Builds every level from minLevel to maxLevel inclusive, spreading row
+// bands of the larger levels over pool when one is given.
+OctantLodSet build_octant_lods(int minLevel, int maxLevel,
+                               ThreadPool *pool = NULL);
+
+// Replaces the triangle lists of lods, which must still be in generation
+// order, with strips; vertices are untouched.
+void strip_octant_lods(OctantLodSet &lods);
+
+// A level has 3n(n+1)/2 distinct edges against 3n^2 in its triangles.
+inline size_t octant_edge_index_count(int level)
+{
+    size_t n = size_t(1) << level;
+    return 3 * n * (n + 1);
+}
+
+// Replaces the triangle lists of lods with lists of their unique edges,
+// keeping the triangles' order; vertices are untouched.
+void edge_octant_lods(OctantLodSet &lods);
+
+// Cache behaviour of one level before and after optimize_octant_lods().
+struct OctantLodCacheStats {
+    int level;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Reorders each level's triangles for the post-transform cache and then its
+// vertices into first-use order. Stats are measured with a FIFO cache of
+// cacheSize entries. Levels are processed in parallel when pool is given.
+std::vector<OctantLodCacheStats> optimize_octant_lods(OctantLodSet &lods,
+                                                      int cacheSize,
+                                                      ThreadPool *pool = NULL);
+
+// Packs lods into the compact format, after any reordering.
+CompactOctantLods compact_octant_lods(const OctantLodSet &lods);
+
+// Picks the coarsest resident level whose edges project to at most
+// pixelsPerEdge pixels, treating the octant as its bounding unit sphere.
+// MV is the model-view matrix and P the projection; viewportHeight is in
+// pixels. Returns an index into lods.lods.
+size_t select_octant_lod(const OctantLodSet &lods, const glm::mat4 &MV,
+                         const glm::mat4 &P, int viewportHeight,
+                         float pixelsPerEdge);
+
+#endif // OCTANT_HPP
@@ -0,0 +1,43 @@
+/*===================================================
+// Compile-time octant meshes for the production levels
+//===================================================*/
+
+#include "octant_baked.hpp"
+
+using namespace std;
+
+// constexpr forces evaluation at compile time and places the result in
+// read-only data.
+static constexpr BakedOctantLods<BAKED_MIN_LEVEL, BAKED_MAX_LEVEL> baked =
+    bake_octant_lods<BAKED_MIN_LEVEL, BAKED_MAX_LEVEL>();
+
+bool baked_octant_lods(int minLevel, int maxLevel, OctantLodSet &set)
+{
+    if (minLevel < BAKED_MIN_LEVEL || maxLevel > BAKED_MAX_LEVEL ||
+        minLevel > maxLevel)
+        return false;
+
+    // the requested levels are a contiguous slice of the baked arrays
+    size_t v = octant_baked::total_vertices(BAKED_MIN_LEVEL, minLevel - 1);
+    size_t e = octant_baked::total_indices(BAKED_MIN_LEVEL, minLevel - 1);
+    set.vertices.clear();
+    set.indices.clear();
+    set.lods.clear();
+    set.bakedVertices = reinterpret_cast<const Vertex*>(&baked.vertices[v]);
+    set.bakedIndices = &baked.indices[e];
+    set.bakedVertexCount = octant_baked::total_vertices(minLevel, maxLevel);
+    set.bakedIndexCount = octant_baked::total_indices(minLevel, maxLevel);
+
+    size_t lv = 0, le = 0;
+    for (int level = minLevel; level <= maxLevel; level++) {
+        OctantLod lod;
+        lod.level = level;
+        lod.baseVertex = static_cast<GLint>(lv);
+        lod.firstIndex = le;
+        lod.indexCount = static_cast<GLsizei>(octant_index_count(level));
+        set.lods.push_back(lod);
+        lv += octant_vertex_count(level);
+        le += octant_index_count(level);
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+/*===================================================
+// Compile-time octant meshes for the production levels
+//===================================================*/
+
+// The same mesh init_octant() builds, evaluated by the compiler so the
+// arrays land in the executable's read-only data: no build cost at startup,
+// and every process running the binary shares the same physical pages.
+
+#ifndef OCTANT_BAKED_HPP
+#define OCTANT_BAKED_HPP
+
+#include <glad/glad.h>
+#include <cstddef>
+#include "octant.hpp"
+
+// Levels compiled into the binary; any contiguous range inside this one can
+// be served without generating anything.
+const int BAKED_MIN_LEVEL = 0;
+const int BAKED_MAX_LEVEL = 7;
+
+// Plain floats because glm's constructors are not usable in constant
+// expressions with this glm version; the layout matches Vertex.
+struct BakedVertex {
+    float x, y, z;
+};
+static_assert(sizeof(BakedVertex) == sizeof(Vertex),
+              "baked vertices must upload like Vertex");
+
+namespace octant_baked {
+
+constexpr double sqrt_newton(double x)
+{
+    // |p|^2 is in [1/3, 1] for every octant vertex, so 1 is a good start
+    double r = 1.0;
+    for (int i = 0; i < 8; i++)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+constexpr size_t vertex_count(int level)
+{
+    return ((size_t(1) << level) + 1) * ((size_t(1) << level) + 2) / 2;
+}
+
+constexpr size_t index_count(int level)
+{
+    return (size_t(1) << level) * (size_t(1) << level) * 3;
+}
+
+constexpr size_t total_vertices(int minLevel, int maxLevel)
+{
+    size_t n = 0;
+    for (int level = minLevel; level <= maxLevel; level++)
+        n += vertex_count(level);
+    return n;
+}
+
+constexpr size_t total_indices(int minLevel, int maxLevel)
+{
+    size_t n = 0;
+    for (int level = minLevel; level <= maxLevel; level++)
+        n += index_count(level);
+    return n;
+}
+
+} // namespace octant_baked
+
+// Levels MinLevel..MaxLevel packed back to back exactly like
+// build_octant_lods() packs them, with indices relative to each level.
+template <int MinLevel, int MaxLevel>
+struct BakedOctantLods {
+    static constexpr size_t NUM_VERTICES =
+        octant_baked::total_vertices(MinLevel, MaxLevel);
+    static constexpr size_t NUM_INDICES =
+        octant_baked::total_indices(MinLevel, MaxLevel);
+
+    BakedVertex vertices[NUM_VERTICES];
+    GLuint indices[NUM_INDICES];
+};
+
+// Mirrors init_octant_rows() step for step.
+template <int MinLevel, int MaxLevel>
+constexpr BakedOctantLods<MinLevel, MaxLevel> bake_octant_lods()
+{
+    BakedOctantLods<MinLevel, MaxLevel> b{};
+    size_t v = 0, e = 0;
+    for (int level = MinLevel; level <= MaxLevel; level++) {
+        const int n = 1 << level;
+        const float d = 1.0f/n;
+        GLuint ll = 0;
+        for (int r = 0; r <= n; r++) {
+            for (int c = 0; c <= n - r; c++) {
+                float x = 1.0f - (r + c)*d, y = c*d, z = r*d;
+                double len = octant_baked::sqrt_newton(double(x)*x +
+                                                       double(y)*y +
+                                                       double(z)*z);
+                b.vertices[v++] = BakedVertex{ float(x/len), float(y/len),
+                                               float(z/len) };
+            }
+            if (r == n)
+                break;
+            for (int s=1; s<n-r+1; s++) {
+                b.indices[e++] = ll + s - 1;
+                b.indices[e++] = ll + s;
+                b.indices[e++] = ll + s + n - r;
+            }
+            for (int t=1; t<n-r; t++) {
+                b.indices[e++] = ll + t;
+                b.indices[e++] = ll + t + n + 1 - r;
+                b.indices[e++] = ll + t + n - r;
+            }
+            ll += n + 1 - r;
+        }
+    }
+    return b;
+}
+
+// Fills set with levels minLevel..maxLevel pointing straight at the baked
+// arrays. Returns false, leaving set alone, if the range is not baked.
+bool baked_octant_lods(int minLevel, int maxLevel, OctantLodSet &set);
+
+#endif // OCTANT_BAKED_HPP
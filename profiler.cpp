@@ -0,0 +1,181 @@
+/*===================================================
+// Per-phase CPU and GPU frame profiler
+//===================================================*/
+
+#include "profiler.hpp"
+#include "bench.hpp"
+#include "gl_extra.hpp"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+static const char* phaseNames[NUM_FRAME_PHASES] = {
+    "clear", "uniforms", "draw", "errors", "capture", "swap", "events"
+};
+
+const int FrameProfiler::RING_SIZE;
+
+FrameProfiler::FrameProfiler()
+    : active(false), gpuTimers(false), frame(0), current(0),
+      phase(NUM_FRAME_PHASES), phaseStart(0)
+{
+    pending[0] = pending[1] = false;
+}
+
+void FrameProfiler::init(bool gpuTimers)
+{
+    this->gpuTimers = gpuTimers;
+    if (gpuTimers)
+        glGenQueries(2*NUM_FRAME_PHASES, &queries[0][0]);
+    active = true;
+}
+
+void FrameProfiler::destroy()
+{
+    if (active && gpuTimers)
+        glDeleteQueries(2*NUM_FRAME_PHASES, &queries[0][0]);
+    active = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+    if (!active)
+        return;
+    current = frame & 1;
+    if (pending[current])
+        collect(current); // issued two frames ago
+    FrameRecord &r = ring[frame % RING_SIZE];
+    r.frame = frame;
+    // phases the frame never enters stay NaN, so they read as absent
+    for (int p = 0; p < NUM_FRAME_PHASES; p++) {
+        r.cpu[p] = numeric_limits<double>::quiet_NaN();
+        r.gpu[p] = numeric_limits<double>::quiet_NaN();
+        issued[current][p] = false;
+    }
+}
+
+void FrameProfiler::beginPhase(FramePhase phase)
+{
+    if (!active)
+        return;
+    this->phase = phase;
+    if (gpuTimers) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[current][phase]);
+        issued[current][phase] = true;
+    }
+    phaseStart = glfwGetTimerValue();
+}
+
+void FrameProfiler::endPhase()
+{
+    if (!active || phase == NUM_FRAME_PHASES)
+        return;
+    uint64_t end = glfwGetTimerValue();
+    if (gpuTimers)
+        glEndQuery(GL_TIME_ELAPSED);
+    double ms = 1000.0 * (end - phaseStart) / glfwGetTimerFrequency();
+    double &cpu = ring[frame % RING_SIZE].cpu[phase];
+    cpu = std::isnan(cpu) ? ms : cpu + ms; // a phase may be entered twice
+    phase = NUM_FRAME_PHASES;
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!active)
+        return;
+    pending[current] = gpuTimers;
+    pendingFrame[current] = frame;
+    frame++;
+}
+
+void FrameProfiler::collect(int set)
+{
+    pending[set] = false;
+    FrameRecord &r = ring[pendingFrame[set] % RING_SIZE];
+    if (r.frame != pendingFrame[set])
+        return; // overwritten; cannot happen while RING_SIZE > 2
+
+    // queries complete in order, so the last one issued decides for all
+    int last = -1;
+    for (int p = 0; p < NUM_FRAME_PHASES; p++) {
+        if (issued[set][p])
+            last = p;
+    }
+    if (last < 0)
+        return;
+    GLint available = 0;
+    glGetQueryObjectiv(queries[set][last], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return; // dropped rather than stalling the pipeline
+    for (int p = 0; p < NUM_FRAME_PHASES; p++) {
+        if (!issued[set][p])
+            continue;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[set][p], GL_QUERY_RESULT, &ns);
+        r.gpu[p] = ns / 1.0e6;
+    }
+}
+
+vector<double> FrameProfiler::samples(FramePhase phase, bool gpu) const
+{
+    vector<double> v;
+    uint64_t count = min<uint64_t>(frame, RING_SIZE);
+    for (uint64_t i = 0; i < count; i++) {
+        double t = gpu ? ring[i].gpu[phase] : ring[i].cpu[phase];
+        if (!std::isnan(t))
+            v.push_back(t);
+    }
+    sort(v.begin(), v.end());
+    return v;
+}
+
+void FrameProfiler::dump(ostream &out) const
+{
+    if (!active)
+        return;
+    uint64_t count = min<uint64_t>(frame, RING_SIZE);
+    out << "Frame profile over the last " << count << " frames (ms)" << endl
+        << "  phase      cpu min   median     mean      max"
+        << "    gpu min   median     mean      max" << endl;
+    ios::fmtflags flags = out.flags();
+    out << fixed << setprecision(3);
+    for (int p = 0; p < NUM_FRAME_PHASES; p++) {
+        out << "  " << left << setw(9) << phaseNames[p] << right;
+        for (int gpu = 0; gpu < 2; gpu++) {
+            vector<double> v = samples(FramePhase(p), gpu != 0);
+            out << (gpu ? "  " : "");
+            if (v.empty()) {
+                out << setw(9) << "-" << setw(9) << "-"
+                    << setw(9) << "-" << setw(9) << "-";
+                continue;
+            }
+            double sum = 0.0;
+            for (double t : v)
+                sum += t;
+            out << setw(9) << v.front() << setw(9) << v[v.size()/2]
+                << setw(9) << sum / v.size() << setw(9) << v.back();
+        }
+        out << endl;
+    }
+    out.flags(flags);
+}
+
+void FrameProfiler::report(BenchReport &report) const
+{
+    if (!active)
+        return;
+    for (int p = 0; p < NUM_FRAME_PHASES; p++) {
+        vector<double> cpu = samples(FramePhase(p), false);
+        vector<double> gpu = samples(FramePhase(p), true);
+        const double none = numeric_limits<double>::quiet_NaN();
+        report.set(string("cpu_ms_") + phaseNames[p],
+                   cpu.empty() ? none : cpu[cpu.size()/2]);
+        report.set(string("gpu_ms_") + phaseNames[p],
+                   gpu.empty() ? none : gpu[gpu.size()/2]);
+    }
+}
@@ -0,0 +1,79 @@
+/*===================================================
+// Per-phase CPU and GPU frame profiler
+//===================================================*/
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <glad/glad.h>
+#include <ostream>
+#include <cstdint>
+#include <vector>
+
+class BenchReport;
+
+// The parts of a frame in the order the render loop runs them.
+enum FramePhase {
+    PHASE_CLEAR,
+    PHASE_UNIFORMS,
+    PHASE_DRAW,
+    PHASE_ERRORS,
+    PHASE_CAPTURE,
+    PHASE_SWAP,
+    PHASE_EVENTS,
+    NUM_FRAME_PHASES
+};
+
+// Brackets each phase with a CPU timestamp and a GL_TIME_ELAPSED query.
+// Query sets are double-buffered: a set is read back two frames after it
+// was issued, and only if the driver reports it available, so the profiler
+// never waits on the GPU. A frame whose results were not ready yet keeps
+// its CPU times and records no GPU times. The last RING_SIZE frames are
+// kept for dump().
+class FrameProfiler {
+public:
+    static const int RING_SIZE = 512;
+
+    FrameProfiler();
+
+    // Creates the queries; gpuTimers is false when ARB_timer_query is
+    // missing, in which case only CPU times are recorded.
+    void init(bool gpuTimers);
+    void destroy();
+    bool enabled() const { return active; }
+
+    void beginFrame();
+    void beginPhase(FramePhase phase);
+    void endPhase();
+    void endFrame();
+
+    // Writes min/median/mean/max per phase over the frames in the ring.
+    void dump(std::ostream &out) const;
+    // Adds the per-phase medians to a benchmark report.
+    void report(BenchReport &report) const;
+
+private:
+    struct FrameRecord {
+        uint64_t frame;
+        double cpu[NUM_FRAME_PHASES]; // milliseconds, NaN if not entered
+        double gpu[NUM_FRAME_PHASES]; // milliseconds, NaN if not read back
+    };
+
+    void collect(int set);
+    // sorted times of one phase over the ring, skipping missing GPU results
+    std::vector<double> samples(FramePhase phase, bool gpu) const;
+
+    bool active;
+    bool gpuTimers;
+    uint64_t frame;
+    int current;          // query set used by this frame
+    FramePhase phase;     // phase currently open, NUM_FRAME_PHASES if none
+    uint64_t phaseStart;  // glfwGetTimerValue() at beginPhase()
+    GLuint queries[2][NUM_FRAME_PHASES];
+    bool issued[2][NUM_FRAME_PHASES];
+    bool pending[2];
+    uint64_t pendingFrame[2];
+    FrameRecord ring[RING_SIZE];
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,139 @@
+/*===================================================
+// On-disk cache of linked shader program binaries
+//===================================================*/
+
+#include "program_cache.hpp"
+#include "gl_extra.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// File layout: magic, format version, binary format and length, then the
+// binary itself. The cache key lives in the file name.
+static const char CACHE_MAGIC[4] = { 'T', '0', 'P', 'B' };
+static const uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+static uint64_t fnv1a(uint64_t hash, const char *s)
+{
+    for (; s && *s; s++) {
+        hash ^= static_cast<unsigned char>(*s);
+        hash *= 1099511628211ull;
+    }
+    // separator so that "ab"+"c" and "a"+"bc" differ
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+static uint64_t cache_key(const char *const *sources, int count)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < count; i++)
+        hash = fnv1a(hash, sources[i]);
+    const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : strings)
+        hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(name)));
+    return hash;
+}
+
+bool program_cache_supported()
+{
+    if (!GLEXTRA_ARB_get_program_binary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+string program_cache_path(const string &prefix, const char *const *sources,
+                          int count)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "-%016llx.bin",
+             static_cast<unsigned long long>(cache_key(sources, count)));
+    return prefix + name;
+}
+
+GLuint load_program_binary(const string &path)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return 0;
+    CacheHeader header;
+    vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+              header.version == CACHE_VERSION && header.length > 0;
+    if (ok) {
+        // a short or overlong file was not written by save_program_binary()
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), f) == binary.size() &&
+             fgetc(f) == EOF;
+    }
+    fclose(f);
+    if (!ok)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), header.length);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool save_program_binary(const string &path, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0 || written > length)
+        return false;
+    binary.resize(written);
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.binaryFormat = format;
+    header.length = static_cast<uint32_t>(written);
+
+    // Write a file of our own next to the cache entry and rename it into
+    // place, so a crash or a second instance never leaves a torn entry.
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%08x.tmp",
+             static_cast<unsigned>(random_device()()));
+    string temp = path + suffix;
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(binary.data(), 1, binary.size(), f) == binary.size();
+    ok = fclose(f) == 0 && ok;
+    if (ok && rename(temp.c_str(), path.c_str()) != 0) {
+        // Windows will not rename over an existing file
+        remove(path.c_str());
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+        remove(temp.c_str());
+    return ok;
+}
@@ -0,0 +1,30 @@
+/*===================================================
+// On-disk cache of linked shader program binaries
+//===================================================*/
+
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <glad/glad.h>
+#include <string>
+
+// True when the context can both save and restore program binaries.
+bool program_cache_supported();
+
+// Returns prefix-<hash>.bin, where the hash covers the shader sources and
+// the GL vendor, renderer and version strings, so a driver update or a
+// shader edit simply misses the cache.
+std::string program_cache_path(const std::string &prefix,
+                               const char *const *sources, int count);
+
+// Restores a program from path. Returns 0 when the file is missing or
+// corrupt, or when the driver rejects the binary; the caller then builds
+// the program from source.
+GLuint load_program_binary(const std::string &path);
+
+// Writes program's binary to path through a temporary file renamed into
+// place, so readers see either the old entry or the complete new one. The
+// program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+bool save_program_binary(const std::string &path, GLuint program);
+
+#endif // PROGRAM_CACHE_HPP
@@ -0,0 +1,107 @@
+/*===================================================
+// Transform hierarchy with cached world matrices
+//===================================================*/
+
+#include "scene_graph.hpp"
+#include <algorithm>
+
+using namespace std;
+using namespace glm;
+
+// translate(t) * mat4_cast(r) * scale(s) without the two matrix products
+static inline mat4 compose(const vec3 &t, const quat &r, const vec3 &s)
+{
+    float xx = r.x*r.x, yy = r.y*r.y, zz = r.z*r.z;
+    float xy = r.x*r.y, xz = r.x*r.z, yz = r.y*r.z;
+    float wx = r.w*r.x, wy = r.w*r.y, wz = r.w*r.z;
+    return mat4(
+        s.x*(1.0f - 2.0f*(yy + zz)), s.x*2.0f*(xy + wz), s.x*2.0f*(xz - wy), 0.0f,
+        s.y*2.0f*(xy - wz), s.y*(1.0f - 2.0f*(xx + zz)), s.y*2.0f*(yz + wx), 0.0f,
+        s.z*2.0f*(xz + wy), s.z*2.0f*(yz - wx), s.z*(1.0f - 2.0f*(xx + yy)), 0.0f,
+        t.x, t.y, t.z, 1.0f);
+}
+
+const SceneGraph::NodeId SceneGraph::NO_PARENT;
+
+SceneGraph::SceneGraph()
+    : firstDirty(0), anyDirty(false), changedBegin(0), changedEnd(0)
+{
+}
+
+void SceneGraph::reserve(size_t count)
+{
+    localT.reserve(count);
+    localR.reserve(count);
+    localS.reserve(count);
+    parents.reserve(count);
+    worlds.reserve(count);
+    dirty.reserve(count);
+    changed.reserve(count);
+}
+
+SceneGraph::NodeId SceneGraph::add(NodeId parent, const vec3 &translation,
+                                   const quat &rotation, const vec3 &scale)
+{
+    NodeId node = static_cast<NodeId>(parents.size());
+    localT.push_back(translation);
+    localR.push_back(rotation);
+    localS.push_back(scale);
+    parents.push_back(parent < node ? parent : NO_PARENT);
+    worlds.push_back(mat4(1.0f));
+    dirty.push_back(0);
+    changed.push_back(0);
+    markDirty(node);
+    return node;
+}
+
+void SceneGraph::markDirty(NodeId node)
+{
+    if (!anyDirty || node < firstDirty)
+        firstDirty = node;
+    dirty[node] = 1;
+    anyDirty = true;
+}
+
+void SceneGraph::setTranslation(NodeId node, const vec3 &t)
+{
+    localT[node] = t;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(NodeId node, const quat &r)
+{
+    localR[node] = r;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(NodeId node, const vec3 &s)
+{
+    localS[node] = s;
+    markDirty(node);
+}
+
+bool SceneGraph::update()
+{
+    if (!anyDirty)
+        return false;
+
+    const size_t count = parents.size();
+    changedBegin = count;
+    changedEnd = firstDirty;
+    fill(changed.begin() + firstDirty, changed.end(), 0);
+    for (size_t i = firstDirty; i < count; i++) {
+        NodeId p = parents[i];
+        // parents precede children, so changed[p] is final by now
+        bool parentChanged = p != NO_PARENT && p >= firstDirty && changed[p];
+        if (!dirty[i] && !parentChanged)
+            continue;
+        mat4 local = compose(localT[i], localR[i], localS[i]);
+        worlds[i] = p == NO_PARENT ? local : worlds[p] * local;
+        dirty[i] = 0;
+        changed[i] = 1;
+        changedBegin = std::min(changedBegin, i);
+        changedEnd = i + 1;
+    }
+    anyDirty = false;
+    return true;
+}
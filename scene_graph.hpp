@@ -0,0 +1,65 @@
+/*===================================================
+// Transform hierarchy with cached world matrices
+//===================================================*/
+
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Nodes are stored as parallel arrays indexed by node id. A parent must be
+// added before its children, so index order is already a topological order
+// and update() is a single forward pass with no recursion or sorting.
+class SceneGraph {
+public:
+    typedef uint32_t NodeId;
+    static const NodeId NO_PARENT = ~NodeId(0);
+
+    SceneGraph();
+
+    void reserve(size_t count);
+    NodeId add(NodeId parent, const glm::vec3 &translation,
+               const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+               const glm::vec3 &scale = glm::vec3(1.0f));
+
+    // Setters only mark the node dirty; world matrices change in update().
+    void setTranslation(NodeId node, const glm::vec3 &t);
+    void setRotation(NodeId node, const glm::quat &r);
+    void setScale(NodeId node, const glm::vec3 &s);
+
+    const glm::vec3& translation(NodeId node) const { return localT[node]; }
+    const glm::quat& rotation(NodeId node) const { return localR[node]; }
+    const glm::vec3& scale(NodeId node) const { return localS[node]; }
+    NodeId parent(NodeId node) const { return parents[node]; }
+
+    // Recomputes the world matrix of every dirty node and everything below
+    // it. Returns false without touching any node when nothing is dirty.
+    // Otherwise [firstChanged, lastChanged) covers every recomputed node.
+    bool update();
+    size_t firstChanged() const { return changedBegin; }
+    size_t lastChanged() const { return changedEnd; }
+
+    size_t size() const { return parents.size(); }
+    const glm::mat4& world(NodeId node) const { return worlds[node]; }
+    const glm::mat4* worldMatrices() const { return worlds.data(); }
+
+private:
+    void markDirty(NodeId node);
+
+    std::vector<glm::vec3> localT;
+    std::vector<glm::quat> localR;
+    std::vector<glm::vec3> localS;
+    std::vector<NodeId> parents;
+    std::vector<glm::mat4> worlds;
+    std::vector<uint8_t> dirty;   // local TRS changed since the last update
+    std::vector<uint8_t> changed; // world recomputed in the current update
+    size_t firstDirty;            // no node before this one is dirty
+    bool anyDirty;
+    size_t changedBegin, changedEnd;
+};
+
+#endif // SCENE_GRAPH_HPP
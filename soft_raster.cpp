@@ -0,0 +1,375 @@
+/*===================================================
+// Tile-binned software rasterizer for the octant scene
+//===================================================*/
+
+#include "soft_raster.hpp"
+#include "thread_pool.hpp"
+#include "batch_transform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/simd/platform.h>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+static_assert(sizeof(Vertex) == sizeof(vec3),
+              "draw() transforms vertex arrays as packed vec3s");
+
+SoftRasterizer::SoftRasterizer(ThreadPool *pool, int tileSize)
+    : pool(pool), tileSize((tileSize + 3) & ~3), fbWidth(0), fbHeight(0),
+      fbStride(0), tilesX(0), tilesY(0), wireMode(SOFT_WIRE_EDGES),
+      background(0xFF000000u), queued(0)
+{
+}
+
+void SoftRasterizer::resize(int width, int height)
+{
+    fbWidth = width;
+    fbHeight = height;
+    fbStride = (size_t(width) + 3) & ~size_t(3);
+    color.assign(fbStride * height, background);
+    depth.assign(fbStride * height, 1.0f);
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    bins.resize(size_t(tilesX) * tilesY);
+}
+
+void SoftRasterizer::clear(uint32_t rgba)
+{
+    background = rgba;
+    std::fill(color.begin(), color.end(), rgba);
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    queued = 0;
+}
+
+static uint32_t scale_color(uint32_t rgba, float s)
+{
+    uint32_t out = rgba & 0xFF000000u;
+    for (int shift = 0; shift < 24; shift += 8)
+        out |= uint32_t(((rgba >> shift) & 0xFF) * s) << shift;
+    return out;
+}
+
+// Sets up one triangle already known to be in front of the near plane.
+// flags bit i marks the edge from p[i] to p[(i+1)%3] as drawn.
+static bool setup_triangle(const vec4 p[3], unsigned flags, int width,
+                           int height, uint32_t edgeColor, uint32_t fill,
+                           SoftTriangle &t)
+{
+    vec3 s[3];
+    for (int i = 0; i < 3; i++) {
+        float invW = 1.0f / p[i].w;
+        s[i] = vec3((p[i].x * invW * 0.5f + 0.5f) * width,
+                    (p[i].y * invW * 0.5f + 0.5f) * height,
+                    p[i].z * invW * 0.5f + 0.5f);
+    }
+    float area = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        const vec3 &pj = s[(i + 1) % 3], &pk = s[(i + 2) % 3];
+        t.a[i] = pj.y - pk.y;
+        t.b[i] = pk.x - pj.x;
+        t.c[i] = -(t.a[i] * pj.x + t.b[i] * pj.y);
+    }
+    area = t.a[0] * s[0].x + t.b[0] * s[0].y + t.c[0];
+    if (std::abs(area) < 1e-8f)
+        return false;
+    if (area < 0.0f) {
+        // either winding is drawn, as with polygon-mode lines
+        for (int i = 0; i < 3; i++) {
+            t.a[i] = -t.a[i];
+            t.b[i] = -t.b[i];
+            t.c[i] = -t.c[i];
+        }
+        area = -area;
+    }
+
+    float minX = std::min(s[0].x, std::min(s[1].x, s[2].x));
+    float maxX = std::max(s[0].x, std::max(s[1].x, s[2].x));
+    float minY = std::min(s[0].y, std::min(s[1].y, s[2].y));
+    float maxY = std::max(s[0].y, std::max(s[1].y, s[2].y));
+    t.minX = std::max(0, int(std::floor(minX)));
+    t.maxX = std::min(width - 1, int(std::ceil(maxX)));
+    t.minY = std::max(0, int(std::floor(minY)));
+    t.maxY = std::min(height - 1, int(std::ceil(maxY)));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return false;
+
+    // edge i lies opposite vertex i, i.e. runs from p[i+1] to p[i+2]
+    t.edgeMask = 0;
+    for (int i = 0; i < 3; i++) {
+        t.invLength[i] = 1.0f / std::sqrt(t.a[i]*t.a[i] + t.b[i]*t.b[i]);
+        if (flags & (1u << ((i + 1) % 3)))
+            t.edgeMask |= 1u << i;
+    }
+    float invArea = 1.0f / area;
+    t.zA = (t.a[0]*s[0].z + t.a[1]*s[1].z + t.a[2]*s[2].z) * invArea;
+    t.zB = (t.b[0]*s[0].z + t.b[1]*s[1].z + t.b[2]*s[2].z) * invArea;
+    t.zC = (t.c[0]*s[0].z + t.c[1]*s[1].z + t.c[2]*s[2].z) * invArea;
+    t.color = edgeColor;
+    t.fill = fill;
+    return true;
+}
+
+// Clips a clip-space triangle against the near plane (z >= -w), then sets
+// up the one or two resulting triangles. Returns how many were written.
+static int clip_triangle(const vec4 v[3], int width, int height,
+                         uint32_t edgeColor, uint32_t fill, SoftTriangle *out)
+{
+    // all three beyond the same side plane: nothing to draw
+    for (int axis = 0; axis < 3; axis++) {
+        if (v[0][axis] > v[0].w && v[1][axis] > v[1].w && v[2][axis] > v[2].w)
+            return 0;
+        if (v[0][axis] < -v[0].w && v[1][axis] < -v[1].w &&
+            v[2][axis] < -v[2].w)
+            return 0;
+    }
+
+    float d[3];
+    int inside = 0;
+    for (int i = 0; i < 3; i++) {
+        d[i] = v[i].z + v[i].w;
+        inside += d[i] >= 0.0f;
+    }
+    if (inside == 3)
+        return setup_triangle(v, 7u, width, height, edgeColor, fill, out[0]);
+    if (inside == 0)
+        return 0;
+
+    // Sutherland-Hodgman; each output vertex carries whether the edge
+    // leaving it is part of an original edge or lies on the near plane
+    vec4 poly[4];
+    bool drawn[4];
+    int n = 0;
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        bool pin = d[i] >= 0.0f, qin = d[j] >= 0.0f;
+        if (pin) {
+            poly[n] = v[i];
+            drawn[n++] = true; // towards v[j] or the plane, along v[i]v[j]
+        }
+        if (pin != qin) {
+            poly[n] = mix(v[i], v[j], d[i] / (d[i] - d[j]));
+            drawn[n++] = qin; // leaving along the plane when v[j] is out
+        }
+    }
+
+    int written = 0;
+    for (int k = 1; k + 1 < n; k++) {
+        vec4 tri[3] = { poly[0], poly[k], poly[k + 1] };
+        unsigned flags = 0;
+        if (k == 1 && drawn[0])
+            flags |= 1u;
+        if (drawn[k])
+            flags |= 2u;
+        if (k + 1 == n - 1 && drawn[n - 1])
+            flags |= 4u;
+        written += setup_triangle(tri, flags, width, height, edgeColor, fill,
+                                  out[written]);
+    }
+    return written;
+}
+
+void SoftRasterizer::draw(const Vertex *vertices, const GLuint *indices,
+                          const SoftDraw *draws, size_t drawCount)
+{
+    vertexStarts.resize(drawCount + 1);
+    triangleStarts.resize(drawCount + 1);
+    triangleCounts.resize(drawCount);
+    vertexStarts[0] = 0;
+    triangleStarts[0] = queued;
+    for (size_t d = 0; d < drawCount; d++) {
+        vertexStarts[d + 1] = vertexStarts[d] + draws[d].vertexCount;
+        // clipping splits a triangle into at most two
+        triangleStarts[d + 1] = triangleStarts[d] + 2 * (draws[d].indexCount / 3);
+    }
+    if (clipVertices.size() < vertexStarts[drawCount])
+        clipVertices.resize(vertexStarts[drawCount]);
+    if (triangles.size() < triangleStarts[drawCount])
+        triangles.resize(triangleStarts[drawCount]);
+
+    auto setup = [&](size_t begin, size_t end) {
+        for (size_t d = begin; d < end; d++) {
+            const SoftDraw &draw = draws[d];
+            vec4 *clip = &clipVertices[vertexStarts[d]];
+            const Vertex *src = vertices + draw.baseVertex;
+            // Vertex is a bare vec3, so the array transforms in one batch
+            transform_points(draw.mvp, &src->position, draw.vertexCount, clip);
+
+            uint32_t fill = wireMode == SOFT_WIRE_SOLID ?
+                scale_color(draw.color, 0.35f) : background;
+            const GLuint *idx = indices + draw.firstIndex;
+            SoftTriangle *out = &triangles[triangleStarts[d]];
+            uint32_t n = 0;
+            for (size_t i = 0; i + 2 < draw.indexCount; i += 3) {
+                vec4 tri[3] = { clip[idx[i]], clip[idx[i + 1]], clip[idx[i + 2]] };
+                n += clip_triangle(tri, fbWidth, fbHeight, draw.color, fill,
+                                   out + n);
+            }
+            triangleCounts[d] = n;
+        }
+    };
+    if (pool)
+        pool->parallelFor(drawCount, 1, setup);
+    else
+        setup(0, drawCount);
+
+    // close the gaps left by culled and unsplit triangles, keeping order
+    for (size_t d = 0; d < drawCount; d++) {
+        size_t src = triangleStarts[d];
+        if (triangleCounts[d] && src != queued)
+            std::copy(&triangles[src], &triangles[src] + triangleCounts[d],
+                      &triangles[queued]);
+        queued += triangleCounts[d];
+    }
+}
+
+void SoftRasterizer::flush()
+{
+    for (vector<uint32_t> &bin : bins)
+        bin.clear();
+    for (size_t i = 0; i < queued; i++) {
+        const SoftTriangle &t = triangles[i];
+        int tx0 = t.minX / tileSize, tx1 = t.maxX / tileSize;
+        int ty0 = t.minY / tileSize, ty1 = t.maxY / tileSize;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                bins[size_t(ty) * tilesX + tx].push_back(uint32_t(i));
+    }
+
+    // tiles own disjoint pixels, so they need no synchronization
+    auto raster = [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++)
+            rasterizeTile(tile);
+    };
+    if (pool)
+        pool->parallelFor(bins.size(), 1, raster);
+    else
+        raster(0, bins.size());
+}
+
+void SoftRasterizer::rasterizeTile(size_t tile)
+{
+    const int tileX0 = int(tile % tilesX) * tileSize;
+    const int tileY0 = int(tile / tilesX) * tileSize;
+    const int tileX1 = std::min(tileX0 + tileSize, fbWidth) - 1;
+    const int tileY1 = std::min(tileY0 + tileSize, fbHeight) - 1;
+    const bool edgesOnly = wireMode == SOFT_WIRE_EDGES;
+
+    for (uint32_t index : bins[tile]) {
+        const SoftTriangle &t = triangles[index];
+        // tiles start on multiples of four, so aligning down stays inside
+        const int x0 = std::max(t.minX, tileX0) & ~3;
+        const int x1 = std::min(t.maxX, tileX1);
+        const int y0 = std::max(t.minY, tileY0);
+        const int y1 = std::min(t.maxY, tileY1);
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        const glm_vec4 a0 = _mm_set1_ps(t.a[0]), a1 = _mm_set1_ps(t.a[1]);
+        const glm_vec4 a2 = _mm_set1_ps(t.a[2]);
+        const glm_vec4 zA = _mm_set1_ps(t.zA);
+        const glm_vec4 inv0 = _mm_set1_ps(t.invLength[0]);
+        const glm_vec4 inv1 = _mm_set1_ps(t.invLength[1]);
+        const glm_vec4 inv2 = _mm_set1_ps(t.invLength[2]);
+        const glm_vec4 draw0 = _mm_castsi128_ps(_mm_set1_epi32(t.edgeMask & 1 ? -1 : 0));
+        const glm_vec4 draw1 = _mm_castsi128_ps(_mm_set1_epi32(t.edgeMask & 2 ? -1 : 0));
+        const glm_vec4 draw2 = _mm_castsi128_ps(_mm_set1_epi32(t.edgeMask & 4 ? -1 : 0));
+        const glm_vec4 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+        const __m128i edgeColor = _mm_set1_epi32(int(t.color));
+        const __m128i fillColor = _mm_set1_epi32(int(t.fill));
+        const __m128i lane = _mm_set_epi32(3, 2, 1, 0);
+        const glm_vec4 laneX = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        for (int y = y0; y <= y1; y++) {
+            const float py = y + 0.5f;
+            uint32_t *crow = &color[size_t(y) * fbStride];
+            float *zrow = &depth[size_t(y) * fbStride];
+            for (int x = x0; x <= x1; x += 4) {
+                glm_vec4 px = glm_vec4_add(_mm_set1_ps(float(x)), laneX);
+                glm_vec4 e0 = glm_vec4_add(glm_vec4_mul(a0, px),
+                                           _mm_set1_ps(t.b[0]*py + t.c[0]));
+                glm_vec4 e1 = glm_vec4_add(glm_vec4_mul(a1, px),
+                                           _mm_set1_ps(t.b[1]*py + t.c[1]));
+                glm_vec4 e2 = glm_vec4_add(glm_vec4_mul(a2, px),
+                                           _mm_set1_ps(t.b[2]*py + t.c[2]));
+                glm_vec4 in = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero),
+                                                    _mm_cmpge_ps(e1, zero)),
+                                         _mm_cmpge_ps(e2, zero));
+                // lanes past x1 may belong to the next tile
+                __m128i last = _mm_set1_epi32(x1 - x);
+                in = _mm_and_ps(in, _mm_castsi128_ps(
+                    _mm_cmpgt_epi32(_mm_add_epi32(last, _mm_set1_epi32(1)), lane)));
+                if (_mm_movemask_ps(in) == 0)
+                    continue;
+
+                glm_vec4 z = glm_vec4_add(glm_vec4_mul(zA, px),
+                                          _mm_set1_ps(t.zB*py + t.zC));
+                glm_vec4 oldZ = _mm_loadu_ps(zrow + x);
+                in = _mm_and_ps(in, _mm_cmplt_ps(z, oldZ));
+
+                glm_vec4 edge = _mm_or_ps(_mm_or_ps(
+                    _mm_and_ps(draw0, _mm_cmplt_ps(glm_vec4_mul(e0, inv0), half)),
+                    _mm_and_ps(draw1, _mm_cmplt_ps(glm_vec4_mul(e1, inv1), half))),
+                    _mm_and_ps(draw2, _mm_cmplt_ps(glm_vec4_mul(e2, inv2), half)));
+                glm_vec4 write = edgesOnly ? _mm_and_ps(in, edge) : in;
+                if (_mm_movemask_ps(write) == 0)
+                    continue;
+
+                __m128i wmask = _mm_castps_si128(write);
+                __m128i emask = _mm_castps_si128(edge);
+                __m128i rgba = _mm_or_si128(_mm_and_si128(emask, edgeColor),
+                                            _mm_andnot_si128(emask, fillColor));
+                __m128i *cdst = reinterpret_cast<__m128i*>(crow + x);
+                __m128i oldC = _mm_loadu_si128(cdst);
+                _mm_storeu_si128(cdst, _mm_or_si128(_mm_and_si128(wmask, rgba),
+                                                    _mm_andnot_si128(wmask, oldC)));
+                _mm_storeu_ps(zrow + x, _mm_or_ps(_mm_and_ps(write, z),
+                                                  _mm_andnot_ps(write, oldZ)));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; y++) {
+            const float py = y + 0.5f;
+            uint32_t *crow = &color[size_t(y) * fbStride];
+            float *zrow = &depth[size_t(y) * fbStride];
+            for (int x = std::max(x0, t.minX); x <= x1; x++) {
+                const float px = x + 0.5f;
+                float e[3];
+                bool in = true, edge = false;
+                for (int i = 0; i < 3; i++) {
+                    e[i] = t.a[i]*px + (t.b[i]*py + t.c[i]); // as the SSE path
+                    in = in && e[i] >= 0.0f;
+                    edge = edge || ((t.edgeMask >> i & 1) &&
+                                    e[i] * t.invLength[i] < 0.5f);
+                }
+                float z = t.zA*px + (t.zB*py + t.zC);
+                if (!in || z >= zrow[x] || (edgesOnly && !edge))
+                    continue;
+                crow[x] = edge ? t.color : t.fill;
+                zrow[x] = z;
+            }
+        }
+#endif
+    }
+}
+
+bool write_ppm(const char *path, const uint32_t *rgba, int width, int height,
+               size_t stride)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    vector<unsigned char> row(size_t(width) * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        const uint32_t *src = rgba + size_t(y) * stride;
+        for (int x = 0; x < width; x++) {
+            row[3*x + 0] = (unsigned char)(src[x] & 0xFF);
+            row[3*x + 1] = (unsigned char)(src[x] >> 8 & 0xFF);
+            row[3*x + 2] = (unsigned char)(src[x] >> 16 & 0xFF);
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    return fclose(f) == 0;
+}
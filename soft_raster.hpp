@@ -0,0 +1,101 @@
+/*===================================================
+// Tile-binned software rasterizer for the octant scene
+//===================================================*/
+
+// Renders the same wireframe scene as the GL path into memory, without a GL
+// context. Draws are transformed and set up in parallel, triangles are
+// binned into square screen tiles, and the tiles are rasterized in parallel
+// with edge functions evaluated four pixels at a time.
+
+#ifndef SOFT_RASTER_HPP
+#define SOFT_RASTER_HPP
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "octant.hpp"
+
+class ThreadPool;
+
+// How edges and interiors are written, as in the shader wireframe modes:
+// edges only, edges with hidden lines removed, or edges over solid faces.
+enum SoftWireMode { SOFT_WIRE_EDGES, SOFT_WIRE_HIDDEN, SOFT_WIRE_SOLID };
+
+// One indexed triangle list drawn with its own transform and color.
+struct SoftDraw {
+    GLint baseVertex;
+    size_t vertexCount;   // vertices from baseVertex the indices reach
+    size_t firstIndex;
+    size_t indexCount;
+    glm::mat4 mvp;
+    uint32_t color;       // RGBA8, red in the lowest byte
+};
+
+// Screen-space triangle ready to rasterize: E_i(x, y) = a*x + b*y + c is
+// positive inside, and edge i is opposite vertex i.
+struct SoftTriangle {
+    float a[3], b[3], c[3];
+    float invLength[3];   // 1/|(a, b)|, turning E_i into pixels
+    float zA, zB, zC;     // window depth is zA*x + zB*y + zC
+    int minX, minY, maxX, maxY;
+    unsigned edgeMask;    // bit i set if edge i is drawn (not a clip edge)
+    uint32_t color;       // edges
+    uint32_t fill;        // interior, for the hidden and solid modes
+};
+
+class SoftRasterizer {
+public:
+    // Setup and tiles are spread over pool when it is given.
+    explicit SoftRasterizer(ThreadPool *pool = NULL, int tileSize = 64);
+
+    void resize(int width, int height);
+    int width() const { return fbWidth; }
+    int height() const { return fbHeight; }
+    void setWireMode(SoftWireMode mode) { wireMode = mode; }
+
+    // Starts a frame: every pixel gets color and depth 1.0.
+    void clear(uint32_t color);
+
+    // Transforms and clips the draws and queues their triangles.
+    void draw(const Vertex *vertices, const GLuint *indices,
+              const SoftDraw *draws, size_t drawCount);
+
+    // Rasterizes everything queued since clear().
+    void flush();
+
+    // Rows run bottom to top like glReadPixels; stride is in pixels.
+    const uint32_t* colorData() const { return color.data(); }
+    size_t stride() const { return fbStride; }
+    size_t triangleCount() const { return queued; }
+
+private:
+    void rasterizeTile(size_t tile);
+
+    ThreadPool *pool;
+    int tileSize;
+    int fbWidth, fbHeight;
+    size_t fbStride;        // a multiple of four, so SSE rows never overrun
+    int tilesX, tilesY;
+    SoftWireMode wireMode;
+    uint32_t background;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+
+    // per frame, kept between frames so steady state does not allocate
+    std::vector<glm::vec4> clipVertices;
+    std::vector<size_t> vertexStarts;       // per draw, into clipVertices
+    std::vector<SoftTriangle> triangles;    // up to two per input triangle
+    std::vector<uint32_t> triangleCounts;   // set up per draw
+    std::vector<size_t> triangleStarts;     // per draw, into triangles
+    std::vector<std::vector<uint32_t> > bins;
+    size_t queued;
+};
+
+// Writes rows bottom to top as a binary PPM, flipping them so the image is
+// upright. Returns false if the file could not be written.
+bool write_ppm(const char *path, const uint32_t *rgba, int width, int height,
+               size_t stride);
+
+#endif // SOFT_RASTER_HPP
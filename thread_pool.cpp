@@ -0,0 +1,108 @@
+/*===================================================
+// Fixed-size worker pool on top of tinycthread
+//===================================================*/
+
+#include "thread_pool.hpp"
+#include <thread>
+
+using namespace std;
+
+int ThreadPool::hardwareThreads()
+{
+    unsigned n = thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+ThreadPool::ThreadPool(int threads)
+    : quit(false), generation(0), busy(0), body(NULL), count(0), grain(1),
+      next(0)
+{
+    if (threads <= 0)
+        threads = hardwareThreads();
+    mtx_init(&lock, mtx_plain);
+    cnd_init(&wake);
+    cnd_init(&finished);
+    for (int i = 1; i < threads; i++) {
+        thrd_t t;
+        if (thrd_create(&t, workerMain, this) != thrd_success)
+            break; // run with fewer workers
+        workers.push_back(t);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    mtx_lock(&lock);
+    quit = true;
+    cnd_broadcast(&wake);
+    mtx_unlock(&lock);
+    for (thrd_t t : workers)
+        thrd_join(t, NULL);
+    cnd_destroy(&finished);
+    cnd_destroy(&wake);
+    mtx_destroy(&lock);
+}
+
+void ThreadPool::runChunks()
+{
+    for (;;) {
+        size_t begin = next.fetch_add(grain);
+        if (begin >= count)
+            break;
+        size_t end = begin + grain < count ? begin + grain : count;
+        (*body)(begin, end);
+    }
+}
+
+int ThreadPool::workerMain(void *arg)
+{
+    ThreadPool *pool = static_cast<ThreadPool*>(arg);
+    unsigned seen = 0;
+    mtx_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->generation == seen)
+            cnd_wait(&pool->wake, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        mtx_unlock(&pool->lock);
+
+        pool->runChunks();
+
+        mtx_lock(&pool->lock);
+        if (--pool->busy == 0)
+            cnd_signal(&pool->finished);
+    }
+    mtx_unlock(&pool->lock);
+    return 0;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain,
+                             const function<void(size_t, size_t)> &body)
+{
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+    if (workers.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    mtx_lock(&lock);
+    this->body = &body;
+    this->count = count;
+    this->grain = grain;
+    next.store(0);
+    busy = static_cast<int>(workers.size());
+    generation++;
+    cnd_broadcast(&wake);
+    mtx_unlock(&lock);
+
+    runChunks();
+
+    mtx_lock(&lock);
+    while (busy > 0)
+        cnd_wait(&finished, &lock);
+    mtx_unlock(&lock);
+}
@@ -0,0 +1,56 @@
+/*===================================================
+// Fixed-size worker pool on top of tinycthread
+//===================================================*/
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+extern "C" {
+#include <tinycthread.h>
+}
+
+// Workers sleep on a condition variable between jobs. parallelFor() hands
+// out chunks of an index range through an atomic counter, so uneven chunks
+// balance themselves, and the calling thread works alongside the pool.
+// Only one thread may call parallelFor() on a pool at a time.
+class ThreadPool {
+public:
+    // threads is the total including the caller; 0 means one per core.
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Calls body(begin, end) over [0, count) in chunks of at most grain
+    // indices and returns once every chunk has finished.
+    void parallelFor(size_t count, size_t grain,
+                     const std::function<void(size_t, size_t)> &body);
+
+    static int hardwareThreads();
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    static int workerMain(void *arg);
+    void runChunks();
+
+    std::vector<thrd_t> workers;
+    mtx_t lock;
+    cnd_t wake;     // a new job was posted, or the pool is shutting down
+    cnd_t finished; // the last worker left the current job
+    bool quit;
+    unsigned generation; // bumped for every job
+    int busy;            // workers still inside the current job
+
+    // current job
+    const std::function<void(size_t, size_t)> *body;
+    size_t count, grain;
+    std::atomic<size_t> next;
+};
+
+#endif // THREAD_POOL_HPP
@@ -5,52 +5,243 @@
 #include <glad/glad.h> // must be included first
 #include <GLFW/glfw3.h>
 #include <iostream>
-#include <array>
+#include <fstream>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include <algorithm>
+#include <chrono>
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <getopt.h>
+#include <vector>
+#include "batch_transform.hpp"
+#include "bench.hpp"
+#include "frame_capture.hpp"
+#include "frustum.hpp"
+#include "gl_debug.hpp"
+#include "gl_extra.hpp"
+#include "indirect.hpp"
+#include "input_log.hpp"
+#include "octant.hpp"
+#include "octant_baked.hpp"
+extern "C" {
+#include <tinycthread.h>
+}
+#include "profiler.hpp"
+#include "program_cache.hpp"
+#include "scene_graph.hpp"
+#include "soft_raster.hpp"
+#include "thread_pool.hpp"
 
 using namespace std;
 using namespace glm;
 
-struct Vertex {
-    vec3 position;
-};
-
-const int NUM_OCTANT_LEVELS = 4;
-const int POW_2_NOL = (1 << NUM_OCTANT_LEVELS); // 2^NUM_OCTANT_LEVELS
-array<Vertex, (POW_2_NOL+1)*(POW_2_NOL+2)/2> octant; // populated in init_octant()
-const int NUM_OCTANT_IDX = POW_2_NOL*POW_2_NOL*3;
-array<GLuint, NUM_OCTANT_IDX> octant_idx; // populated in init_octant()
-
 // Global Parameters
-mat4 M_octant = mat4(1.0f); // model matrix for octant
+int minOctantLevel = 1; // coarsest tessellation kept in the buffers
+int maxOctantLevel = 6; // finest tessellation kept in the buffers
+float lodPixelsPerEdge = 10.0f; // target on-screen edge length for LOD
+bool reorderMesh = true; // optimize index/vertex order before upload
+bool bakedMesh = false; // use the levels compiled into the binary
+bool compactMesh = false; // snorm16 positions and, if they fit, 16-bit indices
+bool stripMesh = false; // triangle strips with primitive restart
+// How edges are drawn: glPolygonMode lines, from barycentric edge
+// distances in the fragment shader (edges only, with hidden lines removed,
+// or over solid faces), or as GL_LINES over each distinct edge once.
+enum WireframeMode { WIRE_POLYGON, WIRE_SHADER, WIRE_HIDDEN, WIRE_SOLID,
+                     WIRE_LINES, WIRE_UNKNOWN };
+WireframeMode wireframeMode = WIRE_POLYGON;
+const char* wireframeModeNames[] = { "polygon", "shader", "hidden", "solid",
+                                     "lines" };
+int numSpheres = 1;
+bool frustumCull = true; // leave spheres outside the view out of the draw
+bool indirectDraw = false; // GL 4.6 multi-draw indirect, a level per sphere
+bool softwareRender = false; // rasterize on the CPU, no GL context at all
+const char* softwareOutput = NULL; // PPM of the last software frame
+bool octantOnly = false; // draw one octant per sphere instead of all eight
+int benchFrames = 0; // nonzero: render this many frames offscreen and exit
+const char* benchOutput = NULL; // JSON report path, stdout when NULL
+const char* capturePattern = NULL; // printf pattern naming a PNG per frame
+const char* streamOutput = NULL; // video file or pipe, "-" for stdout
+CaptureFormat streamFormat = CAPTURE_Y4M;
+const char* streamFormatNames[] = { "png", "y4m", "rgba" };
+FILE* streamFile = NULL;
+bool captureFrames = false; // either of the above
+bool stdoutTaken = false; // the stream owns stdout; text goes to stderr
+int frameWidth = 640, frameHeight = 480; // window or software framebuffer
+bool debugOutput = false; // KHR_debug callback instead of polling glGetError
+bool debugSync = false;
+GLenum debugSource = GL_DONT_CARE; // all sources
+GLenum debugSeverity = GL_DEBUG_SEVERITY_MEDIUM; // and anything worse
+const char* programCache = NULL; // path prefix for cached program binaries
+bool profileFrames = false;
+bool dumpProfile = false; // set by the P key, handled after the frame
+FrameProfiler profiler;
+// Taken first thing in main(), so startup_ms covers option parsing, the
+// mesh thread and context creation alike; GLFW's timer only starts in
+// glfwInit().
+chrono::steady_clock::time_point processStart;
+bool animateSpheres = false; // spin every sphere about its own axis
+bool renderOnDemand = false; // sleep in glfwWaitEvents until something changes
+bool sceneDamaged = true; // input or a resize needs a new frame
+// Model transform for the whole scene, kept as a rigid transform so mouse
+// deltas compose without matrix drift; M_octant is rebuilt from it once per
+// frame when it changes.
+quat modelRotation = quat(1.0f, 0.0f, 0.0f, 0.0f);
+vec3 modelTranslation = vec3(0.0f);
+bool modelDirty = true; // changed since M_octant was last built
+
+// Mouse input gathered over one frame's worth of events, relative to the
+// model transform at the start of the frame. Rotations do not commute, so
+// the handlers compose each drag step in the order it arrived, exactly as
+// if it had been applied on its own; applyInput() then updates the model
+// transform once per frame, so a 1000 Hz mouse costs one quaternion
+// product per event rather than a matrix rebuild.
+struct InputAccumulator {
+    quat rotation;      // drag rotations, composed in arrival order
+    vec3 translation;   // drag translations, in frame-start model space
+    double scroll;
+};
+const InputAccumulator noInput = { quat(1.0f, 0.0f, 0.0f, 0.0f), vec3(0.0f),
+                                   0.0 };
+InputAccumulator input = noInput;
+SceneGraph scene; // one node per sphere, in instance order
 double xCursor;
 double yCursor;
 float mouseSpeed = 0.01f;
 float zoomAngle = 0.30f;
 bool dragRotating = false;
 bool dragTranslating = false;
+const char* recordPath = NULL; // log mouse input here
+const char* replayPath = NULL; // play this log back instead of the mouse
+InputRecorder inputRecorder;
+InputReplay inputReplay;
+const double replayFrameTime = 1.0 / 60.0; // animation step when replaying
+
+// Diagonal reflection matrices taking the +x+y+z octant to the other seven.
+const vec3 octantReflections[8] = {
+    vec3( 1.0f,  1.0f,  1.0f), vec3(-1.0f,  1.0f,  1.0f),
+    vec3( 1.0f, -1.0f,  1.0f), vec3(-1.0f, -1.0f,  1.0f),
+    vec3( 1.0f,  1.0f, -1.0f), vec3(-1.0f,  1.0f, -1.0f),
+    vec3( 1.0f, -1.0f, -1.0f), vec3(-1.0f, -1.0f, -1.0f)
+};
 
 const GLchar* vertexShaderSource = R"glsl(
 #version 330
 uniform mat4 MVP;
+uniform int uOctants; // instances per sphere: 8, or 1 for a lone octant
+uniform vec3 uReflect[8];
 in vec3 posn_obj;
+in mat4 inst_model;
+in vec3 inst_color;
+flat out vec3 color;
 
 void main()
 {
-    gl_Position = MVP * vec4(posn_obj, 1.0);
+    vec3 p = uReflect[gl_InstanceID % uOctants] * posn_obj;
+    gl_Position = MVP * inst_model * vec4(p, 1.0);
+    color = inst_color;
+}
+)glsl";
+
+// --indirect: per-draw data comes from a storage buffer indexed by
+// gl_DrawID rather than from instanced attributes.
+const GLchar* indirectVertexShaderSource = R"glsl(
+#version 460
+uniform mat4 MVP;
+uniform int uOctants;
+uniform vec3 uReflect[8];
+struct DrawData {
+    mat4 model;
+    vec4 color;
+};
+layout(std430, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+in vec3 posn_obj;
+flat out vec3 color;
+
+void main()
+{
+    vec3 p = uReflect[gl_InstanceID % uOctants] * posn_obj;
+    gl_Position = MVP * draws[gl_DrawID].model * vec4(p, 1.0);
+    color = draws[gl_DrawID].color.rgb;
 }
 )glsl";
 
 const GLchar* fragmentShaderSource = R"glsl(
 #version 330
-uniform vec3 uColor;
+flat in vec3 color;
 out vec4 fragColor;
 
 void main()
 {
-    fragColor = vec4(uColor, 1.0);
+    fragColor = vec4(color, 1.0);
+}
+)glsl";
+
+// Shader wireframe: the geometry shader gives each fragment its distance in
+// pixels to the three edges of its triangle, so every edge is drawn by the
+// triangles' own fill instead of as separate lines.
+const GLchar* wireGeometryShaderSource = R"glsl(
+#version 330
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+uniform vec2 uViewport; // framebuffer size in pixels
+flat in vec3 color[];
+flat out vec3 wireColor;
+noperspective out vec3 edgeDist;
+
+void main()
+{
+    vec2 s[3];
+    for (int i = 0; i < 3; i++)
+        s[i] = 0.5 * uViewport * gl_in[i].gl_Position.xy / gl_in[i].gl_Position.w;
+    // twice the area over each opposite edge's length is that vertex's height
+    float area = abs((s[1].x - s[0].x) * (s[2].y - s[0].y) -
+                     (s[2].x - s[0].x) * (s[1].y - s[0].y));
+    vec3 h = area / vec3(length(s[2] - s[1]), length(s[2] - s[0]),
+                         length(s[1] - s[0]));
+    for (int i = 0; i < 3; i++) {
+        gl_Position = gl_in[i].gl_Position;
+        wireColor = color[0];
+        edgeDist = vec3(0.0);
+        edgeDist[i] = h[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
+)glsl";
+
+const GLchar* wireFragmentShaderSource = R"glsl(
+#version 330
+uniform int uWireMode; // 1 edges only, 2 hidden lines removed, 3 solid
+flat in vec3 wireColor;
+noperspective in vec3 edgeDist;
+out vec4 fragColor;
+
+void main()
+{
+    // half a pixel on each side of a shared edge: one pixel, like GL_LINE
+    if (min(edgeDist.x, min(edgeDist.y, edgeDist.z)) < 0.5)
+        fragColor = vec4(wireColor, 1.0);
+    else if (uWireMode == 1)
+        discard;
+    else if (uWireMode == 2)
+        fragColor = vec4(0.0, 0.0, 0.0, 1.0); // the clear color
+    else
+        fragColor = vec4(0.35 * wireColor, 1.0);
 }
 )glsl";
 
@@ -63,58 +254,144 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GLFW_TRUE);
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        dumpProfile = true;
+    sceneDamaged = true;
 }
 
-void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    static const float zoomEpsilon = 0.02f;
-    zoomAngle += yoffset*zoomEpsilon;
+    sceneDamaged = true;
 }
 
-void buttonCallback(GLFWwindow* window, int button, int action, int mods)
-{ // see glfw/examples/wave.c
-    if (button != GLFW_MOUSE_BUTTON_LEFT && button != GLFW_MOUSE_BUTTON_RIGHT)
-        return;
+void refreshCallback(GLFWwindow* window)
+{
+    sceneDamaged = true; // window was exposed or its contents were lost
+}
+
+// The mouse handlers below take everything they need as arguments, so
+// the GLFW callbacks and a replay drive them the same way. The callbacks
+// log what they pass on when recording and ignore the mouse when
+// replaying.
+
+void handleScroll(double yoffset)
+{
+    input.scroll += yoffset;
+    sceneDamaged = true;
+}
+
+// x and y are the cursor position when the button went down.
+void handleButton(int button, int action, double x, double y)
+{
     if (action == GLFW_PRESS) {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        glfwGetCursorPos(window, &xCursor, &yCursor);
+        xCursor = x;
+        yCursor = y;
         if (button == GLFW_MOUSE_BUTTON_LEFT)
             dragRotating = true;
         else
             dragTranslating = true;
     }
     else {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
         dragRotating = false;
         dragTranslating = false;
     }
+    sceneDamaged = true;
 }
 
-void cursorCallback(GLFWwindow* window, double x, double y)
-{ // see glfw/examples/wave.c
-    if (!dragRotating && !dragTranslating)
-        return;
-    static mat4 T;
+void handleCursor(double x, double y)
+{
+    // both deltas are applied in model space, i.e. M = M * T
     if (dragRotating) {
-        T = rotate(mat4(1.0f), (float) (x - xCursor) * mouseSpeed,
-                   vec3(0.0f, 1.0f, 0.0f));
-        T = rotate(T, (float) (y - yCursor) * mouseSpeed,
-                   vec3(1.0f, 0.0f, 0.0f));
+        quat q = angleAxis((float) (x - xCursor) * mouseSpeed,
+                           vec3(0.0f, 1.0f, 0.0f)) *
+                 angleAxis((float) (y - yCursor) * mouseSpeed,
+                           vec3(1.0f, 0.0f, 0.0f));
+        input.rotation = input.rotation * q;
     }
     else {
-        T = translate(mat4(1.0f),
-                      vec3((float) (x - xCursor) * mouseSpeed,
-                           (float) (yCursor - y) * mouseSpeed, 0.0f));
+        // rotated by this frame's earlier drag steps, as it would have been
+        input.translation += input.rotation *
+                             vec3((float) (x - xCursor) * mouseSpeed,
+                                  (float) (yCursor - y) * mouseSpeed, 0.0f);
     }
-    M_octant *= T; // FIXME
     xCursor = x;
     yCursor = y;
+    sceneDamaged = true;
+}
+
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    if (inputReplay.active())
+        return;
+    inputRecorder.record(INPUT_SCROLL, 0, 0, xoffset, yoffset);
+    handleScroll(yoffset);
+}
+
+void buttonCallback(GLFWwindow* window, int button, int action, int mods)
+{ // see glfw/examples/wave.c
+    if (inputReplay.active() ||
+        (button != GLFW_MOUSE_BUTTON_LEFT && button != GLFW_MOUSE_BUTTON_RIGHT))
+        return;
+    glfwSetInputMode(window, GLFW_CURSOR, action == GLFW_PRESS ?
+                     GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    inputRecorder.record(INPUT_BUTTON, button, action, x, y);
+    handleButton(button, action, x, y);
 }
 
+void cursorCallback(GLFWwindow* window, double x, double y)
+{ // see glfw/examples/wave.c
+    // only drags move anything, so only they are worth recording
+    if (inputReplay.active() || (!dragRotating && !dragTranslating))
+        return;
+    inputRecorder.record(INPUT_CURSOR, 0, 0, x, y);
+    handleCursor(x, y);
+}
+
+// Feeds the handlers every replayed event due by this frame.
+void replayInput(int frame)
+{
+    InputEvent e;
+    while (inputReplay.next(uint32_t(frame), e)) {
+        if (e.type == INPUT_BUTTON)
+            handleButton(e.button, e.action, e.x, e.y);
+        else if (e.type == INPUT_CURSOR)
+            handleCursor(e.x, e.y);
+        else
+            handleScroll(e.y);
+    }
+}
+
+// Applies the input gathered since the last frame and clears it.
+void applyInput()
+{
+    static const float zoomEpsilon = 0.02f;
+    if (input.scroll != 0.0)
+        zoomAngle += input.scroll*zoomEpsilon;
+
+    // the translation comes first: it is relative to the frame's start
+    if (input.translation != noInput.translation) {
+        modelTranslation += modelRotation * input.translation;
+        modelDirty = true;
+    }
+    if (input.rotation != noInput.rotation) {
+        modelRotation = normalize(modelRotation * input.rotation);
+        modelDirty = true;
+    }
+    input = noInput;
+}
+
+// Only issues the compile; checkShader() collects the result later so the
+// driver can compile in the background meanwhile.
 void compileShader(GLuint shader, const char *shaderText)
 {
     glShaderSource(shader, 1, &shaderText, NULL);
     glCompileShader(shader);
+}
+
+void checkShader(GLuint shader)
+{
     GLchar infoLog[8192];
     GLint success = 0;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -126,52 +403,720 @@ void compileShader(GLuint shader, const char *shaderText)
     }
 }
 
-void init_octant()
+// A program whose compile and link have been issued but not yet checked.
+// Shaders are 0 when the program was restored from the binary cache.
+struct PendingProgram {
+    GLuint program;
+    GLuint vertexShader;
+    GLuint geometryShader; // 0 when there is none
+    GLuint fragmentShader;
+    string cachePath; // save the binary here once linked, if not empty
+};
+
+// Issues compile and link without querying any status, restoring the
+// program from the on-disk binary cache instead when --program-cache is
+// given and holds a usable binary. status is set to "hit", "miss" or "off".
+// gsText may be NULL for no geometry shader.
+PendingProgram startProgram(const char *vsText, const char *gsText,
+                            const char *fsText, const char *&status)
 {
-    int i = 0;
-    int j = 0;
-    GLuint ll = 0;
-    octant[i].position = vec3(1.0f, 0.0f, 0.0f);
-    float d = 1.0f/(POW_2_NOL);
-    for (int r=0; r<POW_2_NOL; r++) {
-        for (int s=1; s<POW_2_NOL-r+1; s++) {
-            i++;
-            octant[i].position = octant[i-1].position + vec3(-d, d, 0.0f);
-            octant_idx[j++] = ll + s - 1;
-            octant_idx[j++] = ll + s;
-            octant_idx[j++] = ll + s + POW_2_NOL - r;
-        }
-        for (int t=1; t<POW_2_NOL-r; t++) {
-            octant_idx[j++] = ll + t;
-            octant_idx[j++] = ll + t + POW_2_NOL + 1 - r;
-            octant_idx[j++] = ll + t + POW_2_NOL - r;
-        }
-        // move to first entry of next row
-        ll += POW_2_NOL + 1 - r;
-        i++;
-        octant[i].position = octant[i-POW_2_NOL-1+r].position + vec3(-d, 0, d);
-    }
-    for (auto &v : octant) {
-        v.position = normalize(v.position);
-    }
-}
-
-int main(void)
+    PendingProgram p = { 0u, 0u, 0u, 0u, string() };
+    status = "off";
+    if (programCache && program_cache_supported()) {
+        const char *sources[] = { vsText, fsText, gsText };
+        string path = program_cache_path(programCache, sources,
+                                         gsText ? 3 : 2);
+        p.program = load_program_binary(path);
+        if (p.program) {
+            status = "hit";
+            return p;
+        }
+        status = "miss";
+        p.cachePath = path;
+    }
+
+    p.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    p.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    compileShader(p.vertexShader, vsText);
+    compileShader(p.fragmentShader, fsText);
+    if (gsText) {
+        p.geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+        compileShader(p.geometryShader, gsText);
+    }
+    p.program = glCreateProgram();
+    glAttachShader(p.program, p.vertexShader);
+    if (p.geometryShader)
+        glAttachShader(p.program, p.geometryShader);
+    glAttachShader(p.program, p.fragmentShader);
+    if (!p.cachePath.empty())
+        glProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(p.program);
+    return p;
+}
+
+// Waits for a program from startProgram(), reports errors and fills the
+// cache on a miss. Returns 0 on failure.
+GLuint finishProgram(PendingProgram &p)
+{
+    if (!p.vertexShader)
+        return p.program; // restored from the cache, already validated
+    checkShader(p.vertexShader);
+    if (p.geometryShader)
+        checkShader(p.geometryShader);
+    checkShader(p.fragmentShader);
+    GLint success = 0;
+    glGetProgramiv(p.program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        cerr << "ERROR: Shader linking failed." << endl;
+        glDeleteProgram(p.program);
+        p.program = 0u;
+    }
+    glDeleteShader(p.vertexShader);
+    glDeleteShader(p.geometryShader); // 0 is silently ignored
+    glDeleteShader(p.fragmentShader);
+    if (p.program && !p.cachePath.empty() &&
+        !save_program_binary(p.cachePath, p.program))
+        cerr << "Could not write program cache " << p.cachePath << endl;
+    return p.program;
+}
+
+// Geometry built on a worker thread while the main thread creates the
+// context and compiles shaders.
+struct MeshJob {
+    int minLevel, maxLevel;
+    bool reorder;
+    bool baked;
+    bool compact;
+    bool strips;
+    bool edges;
+    ThreadPool *pool;
+    OctantLodSet lods;
+    CompactOctantLods compactLods; // empty unless compact
+    vector<OctantLodCacheStats> cacheStats; // empty unless reordered
+};
+
+int meshThreadMain(void *arg)
+{
+    MeshJob *job = static_cast<MeshJob*>(arg);
+    if (!job->baked ||
+        !baked_octant_lods(job->minLevel, job->maxLevel, job->lods)) {
+        job->lods = build_octant_lods(job->minLevel, job->maxLevel, job->pool);
+        if (job->reorder)
+            job->cacheStats = optimize_octant_lods(job->lods, 16, job->pool);
+    }
+    if (job->strips)
+        strip_octant_lods(job->lods);
+    else if (job->edges)
+        edge_octant_lods(job->lods);
+    if (job->compact)
+        job->compactLods = compact_octant_lods(job->lods);
+    return 0;
+}
+
+// Adds one scene node per sphere, laid out on a square grid in the
+// xz-plane around the origin, and returns the sphere colors.
+vector<vec3> init_spheres(SceneGraph &scene, int count)
+{
+    static const vec3 palette[] = {
+        vec3(0.0f, 0.7f, 0.0f), // dark green
+        vec3(0.0f, 0.4f, 0.8f),
+        vec3(0.8f, 0.3f, 0.0f),
+        vec3(0.6f, 0.0f, 0.6f),
+        vec3(0.7f, 0.6f, 0.0f),
+        vec3(0.0f, 0.6f, 0.6f)
+    };
+    const int paletteSize = sizeof(palette)/sizeof(palette[0]);
+    const float spacing = 2.5f;
+    int side = 1;
+    while (side*side < count)
+        side++;
+    vector<vec3> colors(count);
+    scene.reserve(scene.size() + count);
+    for (int i = 0; i < count; i++) {
+        vec3 offset = spacing * vec3(i % side - 0.5f*(side - 1), 0.0f,
+                                     i / side - 0.5f*(side - 1));
+        scene.add(SceneGraph::NO_PARENT, offset);
+        colors[i] = palette[i % paletteSize];
+    }
+    return colors;
+}
+
+// Scripted camera for --bench: one orbit around the scene while dollying
+// out to three times the normal distance and back, so every level is drawn.
+mat4 benchCamera(int frame, int numFrames)
+{
+    float angle = two_pi<float>() * frame / numFrames;
+    float dolly = 2.0f - cos(2.0f*angle); // 1 at the start, 3 halfway round
+    vec3 eye = dolly * vec3(15.0f*sin(angle), 7.0f, 15.0f*cos(angle));
+    return lookAt(eye, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Starts encoder on the PNG pattern or the video stream, whichever was
+// asked for, and reports what went wrong if it cannot.
+bool startCapture(FrameEncoder &encoder)
+{
+    if (!streamOutput) {
+        if (encoder.start(capturePattern))
+            return true;
+        cerr << "ERROR: Could not start the capture encoder threads." << endl;
+        return false;
+    }
+    if (stdoutTaken) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        streamFile = stdout;
+    } else if (!(streamFile = fopen(streamOutput, "wb"))) {
+        cerr << "ERROR: Could not open " << streamOutput << endl;
+        return false;
+    }
+#ifdef SIGPIPE
+    // a reader that goes away fails the writes instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    // the header rate is nominal; frames are written as fast as they come
+    if (encoder.startStream(streamFile, streamFormat, 60))
+        return true;
+    cerr << "ERROR: Could not start the stream thread." << endl;
+    return false;
+}
+
+// Waits for the last frames, then closes the stream.
+void finishCapture(FrameEncoder &encoder)
+{
+    encoder.finish();
+    if (encoder.failures())
+        cerr << "Could not write " << encoder.failures()
+             << " captured frames" << endl;
+    if (streamFile && streamFile != stdout)
+        fclose(streamFile);
+    streamFile = NULL;
+}
+
+// stallSeconds is the time the render thread spent waiting on capture.
+void reportCapture(BenchReport &report, FrameEncoder &encoder,
+                   double stallSeconds)
+{
+    report.set("captured_frames", static_cast<double>(encoder.framesWritten()));
+    report.set("encoder_threads", encoder.threads());
+    report.set("capture_stall_ms", 1000.0 * stallSeconds);
+    if (streamOutput) {
+        double busy = encoder.busySeconds();
+        report.set("stream_format", streamFormatNames[streamFormat]);
+        // frames out of the pipe per second, sustained over the whole run
+        report.set("stream_fps", busy > 0.0 ? encoder.framesWritten() / busy :
+                                              0.0);
+    }
+}
+
+// Renders the scene with SoftRasterizer instead of OpenGL: the same
+// camera, spheres, culling and per-sphere levels, into a memory
+// framebuffer the size of the window. Draws benchFrames frames plus the
+// startup frame (without --bench, just that one or as many as a replay
+// needs), optionally saves the last one, and reports timings like the GL
+// benchmark. Joins the mesh thread itself so startup includes it.
+int runSoftware(ThreadPool &pool, thrd_t meshThread, MeshJob &meshJob)
 {
+    typedef chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    auto seconds = [](Clock::time_point a, Clock::time_point b) {
+        return chrono::duration<double>(b - a).count();
+    };
+
+    const int width = frameWidth, height = frameHeight;
+    SoftRasterizer raster(&pool);
+    raster.resize(width, height);
+    raster.setWireMode(wireframeMode == WIRE_HIDDEN ? SOFT_WIRE_HIDDEN :
+                       wireframeMode == WIRE_SOLID ? SOFT_WIRE_SOLID :
+                       SOFT_WIRE_EDGES);
+
+    vector<vec3> sphereColors = init_spheres(scene, numSpheres);
+    const size_t sphereCount = sphereColors.size();
+    vector<uint32_t> sphereRGBA(sphereCount);
+    for (size_t i = 0; i < sphereCount; i++)
+        sphereRGBA[i] = packUnorm4x8(vec4(sphereColors[i], 1.0f));
+    const int octantsPerSphere = octantOnly ? 1 : 8;
+    mat4 reflections[8];
+    for (int o = 0; o < 8; o++)
+        reflections[o] = scale(mat4(1.0f), octantReflections[o]);
+
+    thrd_join(meshThread, NULL);
+    const OctantLodSet &octant = meshJob.lods;
+
+    mat4 P = perspective(zoomAngle, float(width) / float(height), 1.0f, 100.0f);
+    mat4 M = translate(mat4(1.0f), modelTranslation) * mat4_cast(modelRotation);
+    mat4 V = lookAt(vec3(0.0f, 7.0f, 15.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    CullBounds bounds;
+    bounds.resize(sphereCount);
+    vector<uint32_t> visible;
+    vector<SoftDraw> draws;
+    FrameEncoder encoder;
+    if (captureFrames && !startCapture(encoder))
+        return EXIT_FAILURE;
+
+    const int frames = benchFrames ? benchFrames + 1 :
+                       std::max(1, int(inputReplay.frames()));
+    double startupTime = 0.0, trianglesDrawn = 0.0, spheresDrawn = 0.0;
+    vector<double> frameTimes;
+    frameTimes.reserve(benchFrames);
+    Clock::time_point frameStart = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        if (benchFrames)
+            V = benchCamera(frame, benchFrames);
+        if (inputReplay.active())
+            replayInput(frame);
+        applyInput();
+        if (modelDirty) {
+            M = translate(mat4(1.0f), modelTranslation) *
+                mat4_cast(modelRotation);
+            modelDirty = false;
+        }
+        P = perspective(zoomAngle, float(width) / float(height), 1.0f, 100.0f);
+        if (animateSpheres) {
+            float t = static_cast<float>(inputReplay.active() ?
+                                         frame * replayFrameTime :
+                                         seconds(start, Clock::now()));
+            for (SceneGraph::NodeId i = 0; i < sphereCount; i++)
+                scene.setRotation(i, angleAxis(t * (0.5f + 0.25f*(i % 5)),
+                                               vec3(0.0f, 1.0f, 0.0f)));
+        }
+        if (scene.update())
+            for (size_t i = scene.firstChanged(); i < scene.lastChanged(); i++)
+                bounds.setFromUnitSphere(i, scene.world(i));
+        mat4 MV = V * M, MVP = P * MV;
+
+        if (frustumCull) {
+            bounds.cull(extract_frustum(MVP), visible);
+        } else {
+            visible.resize(sphereCount);
+            for (size_t i = 0; i < sphereCount; i++)
+                visible[i] = uint32_t(i);
+        }
+        // no shared draw here, so every sphere gets the level it needs
+        draws.clear();
+        for (uint32_t i : visible) {
+            const OctantLod &lod = octant.lods[select_octant_lod(octant,
+                MV * scene.world(i), P, height, lodPixelsPerEdge)];
+            mat4 sphereMVP = MVP * scene.world(i);
+            for (int o = 0; o < octantsPerSphere; o++) {
+                SoftDraw d;
+                d.baseVertex = lod.baseVertex;
+                d.vertexCount = octant_vertex_count(lod.level);
+                d.firstIndex = lod.firstIndex;
+                d.indexCount = size_t(lod.indexCount);
+                d.mvp = sphereMVP * reflections[o];
+                d.color = sphereRGBA[i];
+                draws.push_back(d);
+            }
+            trianglesDrawn += frame ? double(lod.indexCount) / 3.0 *
+                                      octantsPerSphere : 0.0;
+        }
+        raster.clear(0xFF000000u);
+        raster.draw(octant.vertexData(), octant.indexData(), draws.data(),
+                    draws.size());
+        raster.flush();
+        if (captureFrames) {
+            // same bottom-up rows as a GL readback, minus the stride padding
+            CaptureFrame *f = encoder.acquire(width, height);
+            for (int y = 0; y < height; y++)
+                memcpy(&f->pixels[y * f->stride],
+                       raster.colorData() + y * raster.stride(), f->stride);
+            encoder.submit(f);
+        }
+
+        Clock::time_point now = Clock::now();
+        if (frame == 0)
+            startupTime = seconds(processStart, now);
+        else {
+            frameTimes.push_back(seconds(frameStart, now));
+            spheresDrawn += visible.size();
+        }
+        frameStart = now;
+    }
+    if (captureFrames)
+        finishCapture(encoder);
+
+    if (softwareOutput && !write_ppm(softwareOutput, raster.colorData(),
+                                     width, height, raster.stride())) {
+        cerr << "Could not write " << softwareOutput << endl;
+        return EXIT_FAILURE;
+    }
+    if (benchFrames) {
+        double totalTime = 0.0;
+        for (double t : frameTimes)
+            totalTime += t;
+        BenchReport report;
+        report.set("gl_vendor", "none");
+        report.set("gl_renderer", "transform0 software rasterizer");
+        report.set("gl_version", "none");
+        report.set("threads", pool.size());
+        report.set("simd", batch_transform_isa_name(batch_transform_isa()));
+        report.set("width", width);
+        report.set("height", height);
+        report.set("min_level", minOctantLevel);
+        report.set("max_level", maxOctantLevel);
+        report.set("spheres", numSpheres);
+        report.set("wireframe", wireframeModeNames[wireframeMode]);
+        report.set("frames", static_cast<double>(frameTimes.size()));
+        report.set("startup_ms", 1000.0 * startupTime);
+        report.set("frame_ms", summarize_frame_times(frameTimes));
+        report.set("triangles_per_frame", trianglesDrawn / frameTimes.size());
+        report.set("triangles_per_second", trianglesDrawn / totalTime);
+        report.set("spheres_per_frame", spheresDrawn / frameTimes.size());
+        if (inputReplay.active())
+            report.set("replay_events",
+                       static_cast<double>(inputReplay.events()));
+        if (captureFrames)
+            reportCapture(report, encoder, encoder.stallSeconds());
+        if (benchOutput) {
+            ofstream out(benchOutput);
+            report.write(out);
+        }
+        else {
+            report.write(stdoutTaken ? cerr : cout);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+WireframeMode parseWireframeMode(const char *name)
+{
+    for (int i = 0; i < WIRE_UNKNOWN; i++)
+        if (strcmp(name, wireframeModeNames[i]) == 0)
+            return static_cast<WireframeMode>(i);
+    return WIRE_UNKNOWN;
+}
+
+CaptureFormat parseStreamFormat(const char *name)
+{
+    for (int i = CAPTURE_Y4M; i < CAPTURE_UNKNOWN; i++)
+        if (strcmp(name, streamFormatNames[i]) == 0)
+            return static_cast<CaptureFormat>(i);
+    return CAPTURE_UNKNOWN;
+}
+
+void usage()
+{
+    cout << "Usage: transform0 [OPTION]..." << endl
+         << "  -l, --level N        finest octant tessellation level (default "
+         << maxOctantLevel << ")" << endl
+         << "  -m, --min-level N    coarsest octant tessellation level (default "
+         << minOctantLevel << ")" << endl
+         << "  -p, --lod-pixels PX  target edge length in pixels when choosing"
+         << " a level (default " << lodPixelsPerEdge << ")" << endl
+         << "      --no-reorder     upload indices in generation order instead"
+         << " of optimizing them for the vertex cache" << endl
+         << "      --baked          upload the levels compiled into the binary"
+         << " (" << BAKED_MIN_LEVEL << "-" << BAKED_MAX_LEVEL << ")," << endl
+         << "                       in generation order" << endl
+         << "  -c, --compact        upload 16-bit snorm positions and 16-bit"
+         << " indices (up to level " << MAX_SHORT_INDEX_LEVEL << ")" << endl
+         << "  -s, --strips         draw each row as a triangle strip with"
+         << " primitive restart" << endl
+         << "      --wireframe M    draw edges with polygon-mode lines"
+         << " (polygon, the default), or" << endl
+         << "                       in the fragment shader: shader, hidden"
+         << " (hidden lines removed)" << endl
+         << "                       or solid (edges over filled faces); or"
+         << " lines, each edge once" << endl
+         << "  -n, --spheres N      number of spheres to draw (default "
+         << numSpheres << ")" << endl
+         << "      --no-cull        draw every sphere, even those outside the"
+         << " view" << endl
+         << "      --indirect       submit one multi-draw indirect call with a"
+         << " level per sphere" << endl
+         << "                       (needs OpenGL 4.6)" << endl
+         << "      --size WxH       window or software framebuffer size"
+         << " (default " << frameWidth << "x" << frameHeight << ")" << endl
+         << "      --software       rasterize on the CPU without an OpenGL"
+         << " context" << endl
+         << "      --software-out FILE  save the last software frame as a PPM"
+         << " image" << endl
+         << "  -o, --octant         draw a single octant of each sphere" << endl
+         << "  -a, --animate        spin each sphere about its own axis" << endl
+         << "  -w, --wait           only draw a frame after input, a resize or"
+         << " animation; idle otherwise" << endl
+         << "  -b, --bench N        render N frames offscreen along a scripted"
+         << " camera path and print timings as JSON" << endl
+         << "      --bench-out FILE write the benchmark JSON to FILE" << endl
+         << "      --record FILE    log mouse input by frame to FILE" << endl
+         << "      --replay FILE    feed a --record log back one frame at a"
+         << " time instead of the mouse," << endl
+         << "                       at the recorded window size unless --size"
+         << " is given" << endl
+         << "      --capture PATTERN  save every frame as a PNG named by the"
+         << " printf PATTERN," << endl
+         << "                       e.g. frame%05d.png, encoding in the"
+         << " background" << endl
+         << "      --stream FILE    write every frame to FILE, a named pipe"
+         << " or - for stdout, as video" << endl
+         << "      --stream-format F  y4m (4:2:0, the default) or rgba"
+         << " (raw frames, top row first)" << endl
+         << "      --profile        time each frame phase on the CPU and GPU;"
+         << " P or exit prints the profile" << endl
+         << "      --program-cache PREFIX  cache linked program binaries in"
+         << " PREFIX-<hash>.bin" << endl
+         << "  -d, --debug          request a debug context and report GL"
+         << " messages through KHR_debug" << endl
+         << "      --debug-source S only report messages from S: all, api,"
+         << " window-system," << endl
+         << "                       shader-compiler, third-party, application"
+         << " or other (default all)" << endl
+         << "      --debug-severity S  lowest severity to report: high, medium,"
+         << " low or notification" << endl
+         << "                       (default medium)" << endl
+         << "      --debug-sync     deliver debug messages synchronously" << endl
+         << "  -h, --help           show this help" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    processStart = chrono::steady_clock::now();
     GLFWwindow* window;
+    int ch;
+    bool sizeGiven = false;
+
+    enum { LEVEL, MIN_LEVEL, LOD_PIXELS, NO_REORDER, BAKED, COMPACT, STRIPS, WIREFRAME, SPHERES, NO_CULL, INDIRECT, SIZE, SOFTWARE, SOFTWARE_OUT, OCTANT, ANIMATE, WAIT,
+           BENCH, BENCH_OUT, RECORD, REPLAY, CAPTURE, STREAM, STREAM_FORMAT,
+           PROFILE, PROGRAM_CACHE,
+           DEBUG, DEBUG_SOURCE, DEBUG_SEVERITY, DEBUG_SYNC, HELP };
+    const struct option options[] =
+    {
+        { "level",      1, NULL, LEVEL },
+        { "min-level",  1, NULL, MIN_LEVEL },
+        { "lod-pixels", 1, NULL, LOD_PIXELS },
+        { "no-reorder", 0, NULL, NO_REORDER },
+        { "baked",      0, NULL, BAKED },
+        { "compact",    0, NULL, COMPACT },
+        { "strips",     0, NULL, STRIPS },
+        { "wireframe",  1, NULL, WIREFRAME },
+        { "spheres",    1, NULL, SPHERES },
+        { "no-cull",    0, NULL, NO_CULL },
+        { "indirect",   0, NULL, INDIRECT },
+        { "size",       1, NULL, SIZE },
+        { "software",   0, NULL, SOFTWARE },
+        { "software-out",   1, NULL, SOFTWARE_OUT },
+        { "octant",     0, NULL, OCTANT },
+        { "animate",    0, NULL, ANIMATE },
+        { "wait",       0, NULL, WAIT },
+        { "bench",      1, NULL, BENCH },
+        { "bench-out",  1, NULL, BENCH_OUT },
+        { "record",     1, NULL, RECORD },
+        { "replay",     1, NULL, REPLAY },
+        { "capture",    1, NULL, CAPTURE },
+        { "stream",     1, NULL, STREAM },
+        { "stream-format",  1, NULL, STREAM_FORMAT },
+        { "profile",    0, NULL, PROFILE },
+        { "program-cache",  1, NULL, PROGRAM_CACHE },
+        { "debug",          0, NULL, DEBUG },
+        { "debug-source",   1, NULL, DEBUG_SOURCE },
+        { "debug-severity", 1, NULL, DEBUG_SEVERITY },
+        { "debug-sync",     0, NULL, DEBUG_SYNC },
+        { "help",       0, NULL, HELP },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((ch = getopt_long(argc, argv, "l:m:p:csn:oawb:dh", options, NULL)) != -1)
+    {
+        switch (ch)
+        {
+            case 'l':
+            case LEVEL:
+                maxOctantLevel = atoi(optarg);
+                break;
+            case 'm':
+            case MIN_LEVEL:
+                minOctantLevel = atoi(optarg);
+                break;
+            case 'p':
+            case LOD_PIXELS:
+                lodPixelsPerEdge = static_cast<float>(atof(optarg));
+                break;
+            case NO_REORDER:
+                reorderMesh = false;
+                break;
+            case BAKED:
+                bakedMesh = true;
+                break;
+            case 'c':
+            case COMPACT:
+                compactMesh = true;
+                break;
+            case 's':
+            case STRIPS:
+                stripMesh = true;
+                break;
+            case WIREFRAME:
+                wireframeMode = parseWireframeMode(optarg);
+                break;
+            case NO_CULL:
+                frustumCull = false;
+                break;
+            case INDIRECT:
+                indirectDraw = true;
+                break;
+            case SIZE:
+                if (sscanf(optarg, "%dx%d", &frameWidth, &frameHeight) != 2)
+                    frameWidth = 0;
+                sizeGiven = true;
+                break;
+            case SOFTWARE:
+                softwareRender = true;
+                break;
+            case SOFTWARE_OUT:
+                softwareOutput = optarg;
+                softwareRender = true;
+                break;
+            case 'n':
+            case SPHERES:
+                numSpheres = atoi(optarg);
+                break;
+            case 'o':
+            case OCTANT:
+                octantOnly = true;
+                break;
+            case 'a':
+            case ANIMATE:
+                animateSpheres = true;
+                break;
+            case 'w':
+            case WAIT:
+                renderOnDemand = true;
+                break;
+            case 'b':
+            case BENCH:
+                benchFrames = atoi(optarg);
+                break;
+            case BENCH_OUT:
+                benchOutput = optarg;
+                break;
+            case RECORD:
+                recordPath = optarg;
+                break;
+            case REPLAY:
+                replayPath = optarg;
+                break;
+            case CAPTURE:
+                capturePattern = optarg;
+                break;
+            case STREAM:
+                streamOutput = optarg;
+                break;
+            case STREAM_FORMAT:
+                streamFormat = parseStreamFormat(optarg);
+                break;
+            case PROFILE:
+                profileFrames = true;
+                break;
+            case PROGRAM_CACHE:
+                programCache = optarg;
+                break;
+            case 'd':
+            case DEBUG:
+                debugOutput = true;
+                break;
+            case DEBUG_SOURCE:
+                debugSource = parse_debug_source(optarg);
+                debugOutput = true;
+                break;
+            case DEBUG_SEVERITY:
+                debugSeverity = parse_debug_severity(optarg);
+                debugOutput = true;
+                break;
+            case DEBUG_SYNC:
+                debugSync = true;
+                debugOutput = true;
+                break;
+            case 'h':
+            case HELP:
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (maxOctantLevel < 0 || maxOctantLevel > MAX_OCTANT_LEVEL ||
+        minOctantLevel < 0 || minOctantLevel > maxOctantLevel ||
+        lodPixelsPerEdge <= 0.0f || numSpheres < 1 || benchFrames < 0 ||
+        debugSource == GL_NONE || debugSeverity == GL_NONE ||
+        wireframeMode == WIRE_UNKNOWN ||
+        (stripMesh && wireframeMode == WIRE_LINES) ||
+        frameWidth < 1 || frameHeight < 1 ||
+        streamFormat == CAPTURE_UNKNOWN || (capturePattern && streamOutput) ||
+        (recordPath && (replayPath || softwareRender)))
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+    if (replayPath) {
+        if (!inputReplay.load(replayPath)) {
+            cerr << "ERROR: " << replayPath << " is not an input log" << endl;
+            exit(EXIT_FAILURE);
+        }
+        if (!sizeGiven) {
+            frameWidth = inputReplay.width;
+            frameHeight = inputReplay.height;
+        }
+    }
+    captureFrames = capturePattern || streamOutput;
+    stdoutTaken = streamOutput && strcmp(streamOutput, "-") == 0;
+    // the software rasterizer reads float triangle lists
+    if (softwareRender)
+        stripMesh = compactMesh = false;
+    // strips index the vertices in generation order
+    if (stripMesh)
+        reorderMesh = false;
+    if (bakedMesh) {
+        if (minOctantLevel < BAKED_MIN_LEVEL || maxOctantLevel > BAKED_MAX_LEVEL) {
+            cerr << "Levels " << minOctantLevel << "-" << maxOctantLevel
+                 << " are not all baked in; generating them at startup" << endl;
+            bakedMesh = false;
+        } else {
+            // the baked arrays are read-only, so they keep generation order
+            reorderMesh = false;
+        }
+    }
+
+    // Start on the geometry right away; nothing below needs it until upload.
+    ThreadPool pool;
+    MeshJob meshJob;
+    meshJob.pool = &pool;
+    meshJob.minLevel = minOctantLevel;
+    meshJob.maxLevel = maxOctantLevel;
+    meshJob.reorder = reorderMesh;
+    meshJob.baked = bakedMesh;
+    meshJob.compact = compactMesh;
+    meshJob.strips = stripMesh;
+    meshJob.edges = wireframeMode == WIRE_LINES && !softwareRender;
+    thrd_t meshThread;
+    if (thrd_create(&meshThread, meshThreadMain, &meshJob) != thrd_success)
+    {
+        cerr << "ERROR: Could not start the mesh thread." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (softwareRender)
+        exit(runSoftware(pool, meshThread, meshJob));
 
     glfwSetErrorCallback(errorCallback);
 
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
-    // Request OpenGL version 3.3.
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Request OpenGL 3.3, or 4.6 for --indirect (multi-draw indirect and SSBOs).
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, indirectDraw ? 4 : 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, indirectDraw ? 6 : 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Don't use old OpenGL
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE); // OSX needs this
+    // Benchmarks never show the window; build GLFW with GLFW_USE_OSMESA to
+    // run them without a display at all (see glfw/examples/offscreen.c).
+    if (benchFrames)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (debugOutput)
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 
-    window = glfwCreateWindow(640, 480, "CS 150 Template Project", NULL, NULL);
+    window = glfwCreateWindow(frameWidth, frameHeight, "CS 150 Template Project", NULL, NULL);
     if (!window)
     {
         glfwTerminate();
@@ -182,93 +1127,519 @@ int main(void)
     glfwSetScrollCallback(window, scrollCallback);
     glfwSetMouseButtonCallback(window, buttonCallback);
     glfwSetCursorPosCallback(window, cursorCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    if (recordPath) {
+        int w, h;
+        glfwGetWindowSize(window, &w, &h);
+        if (!inputRecorder.open(recordPath, w, h)) {
+            cerr << "ERROR: Could not open " << recordPath << endl;
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+    }
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
-    cout << "GL version: " << glGetString(GL_VERSION) << endl
+    load_gl_extra();
+    if (!GLEXTRA_VERSION_3_3)
+    {
+        cerr << "ERROR: OpenGL 3.3 instanced arrays are not available." << endl;
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+    if (indirectDraw && !GLEXTRA_VERSION_4_6)
+    {
+        cerr << "ERROR: --indirect needs OpenGL 4.6 multi-draw indirect." << endl;
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+    if (debugOutput && !install_gl_debug_output(debugSource, debugSeverity,
+                                                debugSync))
+    {
+        cerr << "KHR_debug is not available; falling back to glGetError."
+             << endl;
+        debugOutput = false;
+    }
+
+    // keep stdout clean for the JSON report when benchmarking
+    ostream &info = benchFrames || stdoutTaken ? cerr : cout;
+    info << "GL version: " << glGetString(GL_VERSION) << endl
          << "GL vendor: " << glGetString(GL_VENDOR) << endl
          << "GL renderer: " << glGetString(GL_RENDERER) << endl
          << "GL shading language version: "
          << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
 
-    glfwSwapInterval(1); // Framerate matches monitor refresh rate
-
-    // Compile shaders and check for errors
-    GLuint vertexShader, fragmentShader, program;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    compileShader(vertexShader, vertexShaderSource);
-    compileShader(fragmentShader, fragmentShaderSource);
-    program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-    GLint success = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        cerr << "ERROR: Shader linking failed." << endl;
-        glDeleteProgram(program);
-        program = 0u;
+    if (benchFrames)
+        glfwSwapInterval(0); // measure the renderer, not the display
+    else
+        glfwSwapInterval(1); // Framerate matches monitor refresh rate
+
+    // Issue the shader compile (or restore it from the cache), let it run
+    // while the mesh thread finishes, and only then check for errors.
+    if (GLEXTRA_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // as many as the driver likes
+    double programStart = glfwGetTime();
+    const char *programCacheStatus;
+    const bool shaderWire = wireframeMode == WIRE_SHADER ||
+                            wireframeMode == WIRE_HIDDEN ||
+                            wireframeMode == WIRE_SOLID;
+    PendingProgram pendingProgram = startProgram(
+        indirectDraw ? indirectVertexShaderSource : vertexShaderSource,
+        shaderWire ? wireGeometryShaderSource : NULL,
+        shaderWire ? wireFragmentShaderSource : fragmentShaderSource,
+        programCacheStatus);
+
+    thrd_join(meshThread, NULL);
+    OctantLodSet &octant = meshJob.lods;
+    if (reorderMesh) {
+        // ACMR: vertices transformed per triangle; ATVR: per unique vertex
+        info << "Vertex cache (FIFO 16)  ACMR before/after"
+             << "  ATVR before/after" << endl;
+        for (const OctantLodCacheStats &s : meshJob.cacheStats)
+            info << "  level " << s.level << ": "
+                 << s.before.acmr << " / " << s.after.acmr << "  "
+                 << s.before.atvr << " / " << s.after.atvr << endl;
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+
+    GLuint program = finishProgram(pendingProgram);
+    double programTime = glfwGetTime() - programStart;
+    info << "Shader program ready in " << 1000.0 * programTime << " ms"
+         << " (program cache " << programCacheStatus << ")" << endl;
     glUseProgram(program);
 
     GLint l_MVP = glGetUniformLocation(program, "MVP");
-    GLint l_uColor = glGetUniformLocation(program, "uColor");
+    GLint l_uOctants = glGetUniformLocation(program, "uOctants");
+    GLint l_uReflect = glGetUniformLocation(program, "uReflect");
+    GLint l_uViewport = glGetUniformLocation(program, "uViewport");
+    GLint l_uWireMode = glGetUniformLocation(program, "uWireMode");
     GLint l_posn_obj = glGetAttribLocation(program, "posn_obj");
+    GLint l_inst_model = glGetAttribLocation(program, "inst_model");
+    GLint l_inst_color = glGetAttribLocation(program, "inst_color");
+
+    const GLuint octantsPerSphere = octantOnly ? 1 : 8;
+    glUniform1i(l_uOctants, octantsPerSphere);
+    glUniform3fv(l_uReflect, 8, value_ptr(octantReflections[0]));
+    glUniform1i(l_uWireMode, wireframeMode); // ignored by the plain program
 
-    init_octant();
     // Send data to OpenGL context
-    GLuint VAO, VBO, EBO;
+    GLuint VAO, VBO, EBO, instanceVBO = 0;
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
     glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, octant.size() * sizeof(Vertex),
-                 octant.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(l_posn_obj);
-    glVertexAttribPointer(l_posn_obj, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<const GLvoid*>(0));
+    const CompactOctantLods &compact = meshJob.compactLods;
+    if (compactMesh) {
+        glBufferData(GL_ARRAY_BUFFER,
+                     compact.vertices.size() * sizeof(CompactVertex),
+                     compact.vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(l_posn_obj, 3, GL_SHORT, GL_TRUE,
+                              sizeof(CompactVertex),
+                              reinterpret_cast<const GLvoid*>(0));
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, octant.vertexCount() * sizeof(Vertex),
+                     octant.vertexData(), GL_STATIC_DRAW);
+        glVertexAttribPointer(l_posn_obj, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(Vertex), reinterpret_cast<const GLvoid*>(0));
+    }
     glGenBuffers(1, &EBO); // element buffer (indices)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, octant_idx.size()*sizeof(GLuint),
-                 octant_idx.data(), GL_STATIC_DRAW);
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexSize = sizeof(GLuint);
+    if (!compact.indices.empty()) {
+        indexType = GL_UNSIGNED_SHORT;
+        indexSize = sizeof(GLushort);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, compact.indices.size()*indexSize,
+                     compact.indices.data(), GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, octant.indexCount()*indexSize,
+                     octant.indexData(), GL_STATIC_DRAW);
+    }
+
+    // Every sphere is octantsPerSphere consecutive instances sharing one
+    // model matrix and color, so the per-sphere attributes use that divisor.
+    // Model matrices come straight from the scene graph's world matrices and
+    // are re-uploaded only over the range update() recomputed. With culling,
+    // both buffers instead hold just the visible spheres, repacked whenever
+    // that set or any of its matrices changes.
+    vector<vec3> sphereColors = init_spheres(scene, numSpheres);
+    const size_t sphereCount = sphereColors.size();
+    GLuint colorVBO = 0, indirectBuffer = 0, drawDataBuffer = 0;
+    if (indirectDraw) {
+        // commands and per-draw data are rebuilt whenever the view or the
+        // scene changes; both buffers stay bound for the whole run
+        glGenBuffers(1, &indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glGenBuffers(1, &drawDataBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer);
+    }
+    else {
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sphereCount * sizeof(mat4), NULL,
+                     GL_DYNAMIC_DRAW);
+        for (int c = 0; c < 4; c++) {
+            glEnableVertexAttribArray(l_inst_model + c);
+            glVertexAttribPointer(l_inst_model + c, 4, GL_FLOAT, GL_FALSE,
+                sizeof(mat4), reinterpret_cast<const GLvoid*>(c*sizeof(vec4)));
+            glVertexAttribDivisor(l_inst_model + c, octantsPerSphere);
+        }
+        glGenBuffers(1, &colorVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, colorVBO);
+        glBufferData(GL_ARRAY_BUFFER, sphereCount * sizeof(vec3),
+                     sphereColors.data(),
+                     frustumCull ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+        glEnableVertexAttribArray(l_inst_color);
+        glVertexAttribPointer(l_inst_color, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(vec3), reinterpret_cast<const GLvoid*>(0));
+        glVertexAttribDivisor(l_inst_color, octantsPerSphere);
+    }
+    IndirectDrawBuilder drawBuilder;
 
     glEnable(GL_DEPTH_TEST);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // wireframe mode
-    mat4 V, P, MVP;
+    if (wireframeMode == WIRE_POLYGON)
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // wireframe mode
+    const GLenum primitive = octant.primitive;
+    if (primitive == GL_TRIANGLE_STRIP) {
+        // GL 3.3 has no fixed-index restart, so name the all-ones index
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(indexType == GL_UNSIGNED_SHORT ?
+                                0xFFFF : OCTANT_RESTART_INDEX);
+    }
+    mat4 V, P, VP, M_octant, MV, MVP;
     vec3 eye = vec3(0.0f, 7.0f, 15.0f);
     vec3 center = vec3(0.0f, 0.0f, 0.0f);
     vec3 up = vec3(0.0f, 1.0f, 0.0f);
     V = lookAt(eye, center, up);
 
+    if (profileFrames)
+        profiler.init(GLEXTRA_ARB_timer_query != 0);
+
+    // Frames are read back a few frames late through pixel buffers and
+    // encoded on their own threads, so capturing does not stall the loop.
+    FrameEncoder encoder;
+    PboReadback readback;
+    if (captureFrames) {
+        if (!startCapture(encoder)) {
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+        readback.init(&encoder);
+    }
+
+    // P and V only change with the zoom, the framebuffer size or (when
+    // benchmarking) the camera path, and MVP only when they or M_octant do.
+    float cachedZoom = -1.0f;
+    int cachedWidth = -1, cachedHeight = -1;
+    bool viewDirty = true;
+    size_t lodIndex = 0;
+
+    // Culling state: world bounds per sphere and the spheres now in the
+    // instance buffers, with staging for repacking them.
+    CullBounds bounds;
+    bounds.resize(sphereCount);
+    vector<uint32_t> visible, drawn;
+    vector<mat4> drawnModels;
+    vector<vec3> drawnColors;
+    size_t drawnSpheres = sphereCount;
+
+    // Benchmark bookkeeping; frame 0 ends startup and is not in the stats.
+    int frame = 0;
+    double startupTime = 0.0, frameStart = glfwGetTime();
+    double trianglesDrawn = 0.0;
+    double indicesDrawn = 0.0;
+    double spheresDrawn = 0.0;
+    vector<double> frameTimes, submitTimes;
+    frameTimes.reserve(benchFrames);
+    submitTimes.reserve(benchFrames);
+
     while (!glfwWindowShouldClose(window))
     {
         float ratio;
         int width, height;
 
+        if (benchFrames) {
+            if (frame > benchFrames)
+                break;
+            V = benchCamera(frame, benchFrames);
+            viewDirty = true;
+        }
+        else if (inputReplay.active() && frame > 0 &&
+                 frame >= int(inputReplay.frames())) {
+            break;
+        }
+        sceneDamaged = false; // anything from here on needs another frame
+        profiler.beginFrame();
+
+        profiler.beginPhase(PHASE_CLEAR);
         glfwGetFramebufferSize(window, &width, &height);
         glViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        profiler.endPhase();
+
+        profiler.beginPhase(PHASE_UNIFORMS);
+        if (inputReplay.active())
+            replayInput(frame);
+        applyInput();
+        inputRecorder.nextFrame();
+        if (zoomAngle != cachedZoom || width != cachedWidth ||
+            height != cachedHeight) {
+            ratio = static_cast<float>(width) / static_cast<float>(height);
+            P = perspective(zoomAngle, ratio, 1.0f, 100.0f);
+            glUniform2f(l_uViewport, float(width), float(height));
+            cachedZoom = zoomAngle;
+            cachedWidth = width;
+            cachedHeight = height;
+            viewDirty = true;
+        }
+        if (viewDirty)
+            VP = P * V;
+        if (modelDirty)
+            M_octant = translate(mat4(1.0f), modelTranslation) *
+                       mat4_cast(modelRotation);
+        bool mvpChanged = viewDirty || modelDirty;
+        if (mvpChanged) {
+            MV = V * M_octant;
+            MVP = VP * M_octant;
+            glUniformMatrix4fv(l_MVP, 1, GL_FALSE, value_ptr(MVP));
+            viewDirty = modelDirty = false;
+        }
 
-        ratio = static_cast<float>(width) / static_cast<float>(height);
-        P = perspective(zoomAngle, ratio, 1.0f, 100.0f);
-        MVP = P * V * M_octant;
+        if (animateSpheres) {
+            // a replay steps time by the frame, so it animates the same
+            float t = static_cast<float>(inputReplay.active() ?
+                                         frame * replayFrameTime :
+                                         glfwGetTime());
+            for (SceneGraph::NodeId i = 0; i < sphereCount; i++)
+                scene.setRotation(i, angleAxis(t * (0.5f + 0.25f*(i % 5)),
+                                               vec3(0.0f, 1.0f, 0.0f)));
+        }
+        bool sceneChanged = scene.update();
+        double submitStart = glfwGetTime();
+        bool drawnChanged = false;
+        if (frustumCull) {
+            if (sceneChanged)
+                for (size_t i = scene.firstChanged(); i < scene.lastChanged(); i++)
+                    bounds.setFromUnitSphere(i, scene.world(i));
+            if (mvpChanged || sceneChanged) {
+                // M_octant sits above the scene graph, so cull in its space
+                bounds.cull(extract_frustum(MVP), visible);
+                if (sceneChanged || visible != drawn) {
+                    drawn = visible;
+                    drawnChanged = true;
+                }
+            }
+            drawnSpheres = drawn.size();
+        }
+        // the indirect path rebuilds its storage buffer below instead
+        if (!indirectDraw && frustumCull) {
+            if (drawnChanged) {
+                drawnModels.resize(drawn.size());
+                drawnColors.resize(drawn.size());
+                for (size_t k = 0; k < drawn.size(); k++) {
+                    drawnModels[k] = scene.world(drawn[k]);
+                    drawnColors[k] = sphereColors[drawn[k]];
+                }
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferSubData(GL_ARRAY_BUFFER, 0,
+                                drawn.size() * sizeof(mat4),
+                                drawnModels.data());
+                glBindBuffer(GL_ARRAY_BUFFER, colorVBO);
+                glBufferSubData(GL_ARRAY_BUFFER, 0,
+                                drawn.size() * sizeof(vec3),
+                                drawnColors.data());
+            }
+        }
+        else if (!indirectDraw && sceneChanged) {
+            size_t first = scene.firstChanged(), last = scene.lastChanged();
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(mat4),
+                            (last - first) * sizeof(mat4),
+                            scene.worldMatrices() + first);
+        }
 
-        glUniformMatrix4fv(l_MVP, 1, GL_FALSE, value_ptr(MVP));
-        glUniform3f(l_uColor, 0.0f, 0.7f, 0.0f); // dark green
-        glDrawElements(GL_TRIANGLES, octant_idx.size(), GL_UNSIGNED_INT, 0);
+        if (indirectDraw && (mvpChanged || sceneChanged)) {
+            // one command per sphere, each at the level it needs itself
+            drawBuilder.clear();
+            for (size_t k = 0; k < drawnSpheres; k++) {
+                SceneGraph::NodeId i = frustumCull ? drawn[k] : k;
+                size_t level = select_octant_lod(octant, MV * scene.world(i),
+                                                 P, height, lodPixelsPerEdge);
+                drawBuilder.add(octant.lods[level], octantsPerSphere,
+                                scene.world(i), sphereColors[i]);
+            }
+            glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                         drawBuilder.size() * sizeof(DrawElementsIndirectCommand),
+                         drawBuilder.commandData(), GL_DYNAMIC_DRAW);
+            glBufferData(GL_SHADER_STORAGE_BUFFER,
+                         drawBuilder.size() * sizeof(IndirectDrawData),
+                         drawBuilder.drawData(), GL_DYNAMIC_DRAW);
+        }
+        // all spheres share one draw, so use the level the nearest one needs
+        else if (mvpChanged || sceneChanged) {
+            lodIndex = 0;
+            for (size_t k = 0; k < drawnSpheres; k++) {
+                SceneGraph::NodeId i = frustumCull ? drawn[k] : k;
+                lodIndex = std::max(lodIndex, select_octant_lod(octant,
+                    MV * scene.world(i), P, height, lodPixelsPerEdge));
+            }
+        }
+        const OctantLod &lod = octant.lods[lodIndex];
+        profiler.endPhase();
 
-        // check for OpenGL errors
-        GLenum error_code;
-        while ((error_code = glGetError()) != GL_NO_ERROR)
-            cerr << "OpenGL error HEX: " << hex << error_code << endl;
+        profiler.beginPhase(PHASE_DRAW);
+        double triangles, indices;
+        if (indirectDraw) {
+            glMultiDrawElementsIndirect(primitive, indexType, 0,
+                static_cast<GLsizei>(drawBuilder.size()), 0);
+            triangles = drawBuilder.triangles();
+            indices = 0.0;
+            for (size_t k = 0; k < drawBuilder.size(); k++)
+                indices += double(drawBuilder.commandData()[k].count) *
+                           octantsPerSphere;
+        } else {
+            glDrawElementsInstancedBaseVertex(primitive, lod.indexCount,
+                indexType,
+                reinterpret_cast<const GLvoid*>(lod.firstIndex*indexSize),
+                octantsPerSphere*drawnSpheres, lod.baseVertex);
+            triangles = octant_index_count(lod.level)/3.0 *
+                        octantsPerSphere*drawnSpheres;
+            indices = double(lod.indexCount) * octantsPerSphere*drawnSpheres;
+        }
+        double submitTime = glfwGetTime() - submitStart;
+        profiler.endPhase();
 
+#ifndef NDEBUG
+        // check for OpenGL errors; release builds and --debug skip this
+        // synchronous round trip
+        if (!debugOutput) {
+            profiler.beginPhase(PHASE_ERRORS);
+            GLenum error_code;
+            while ((error_code = glGetError()) != GL_NO_ERROR)
+                cerr << "OpenGL error HEX: " << hex << error_code << endl;
+            profiler.endPhase();
+        }
+#endif
+
+        if (captureFrames) {
+            profiler.beginPhase(PHASE_CAPTURE);
+            readback.capture(width, height);
+            profiler.endPhase();
+        }
+
+        profiler.beginPhase(PHASE_SWAP);
         glfwSwapBuffers(window);
+        profiler.endPhase();
+
+        profiler.beginPhase(PHASE_EVENTS);
         glfwPollEvents();
+        profiler.endPhase();
+        profiler.endFrame();
+        if (dumpProfile) {
+            profiler.dump(cerr);
+            dumpProfile = false;
+        }
+
+        // Benchmarks, replays and animation always want the next frame;
+        // otherwise block until a callback reports damage.
+        if (renderOnDemand && !benchFrames && !inputReplay.active() &&
+            !animateSpheres) {
+            while (!sceneDamaged && !glfwWindowShouldClose(window))
+                glfwWaitEvents();
+        }
+
+        if (benchFrames) {
+            glFinish(); // charge the GPU work to the frame that issued it
+            double now = glfwGetTime();
+            if (frame == 0) {
+                startupTime = chrono::duration<double>(
+                    chrono::steady_clock::now() - processStart).count();
+            }
+            else {
+                frameTimes.push_back(now - frameStart);
+                submitTimes.push_back(submitTime);
+                trianglesDrawn += triangles;
+                indicesDrawn += indices;
+                spheresDrawn += drawnSpheres;
+            }
+            frameStart = now;
+        }
+        frame++;
+    }
+
+    if (captureFrames) {
+        readback.finish();
+        readback.destroy();
+        finishCapture(encoder);
     }
+    if (inputRecorder.active()) {
+        size_t events = inputRecorder.events();
+        if (inputRecorder.close())
+            info << "Recorded " << events << " input events to " << recordPath
+                 << endl;
+        else
+            cerr << "Could not write " << recordPath << endl;
+    }
+
+    if (benchFrames) {
+        double totalTime = 0.0;
+        for (double t : frameTimes)
+            totalTime += t;
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+
+        BenchReport report;
+        report.set("gl_vendor", reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+        report.set("gl_renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        report.set("gl_version", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        report.set("width", width);
+        report.set("height", height);
+        report.set("min_level", minOctantLevel);
+        report.set("max_level", maxOctantLevel);
+        report.set("spheres", numSpheres);
+        report.set("vertex_bytes", static_cast<double>(compactMesh ?
+                   sizeof(CompactVertex) : sizeof(Vertex)));
+        report.set("index_bytes", static_cast<double>(indexSize));
+        report.set("primitive", primitive == GL_LINES ? "lines" :
+                   primitive == GL_TRIANGLE_STRIP ? "strips" : "triangles");
+        report.set("wireframe", wireframeModeNames[wireframeMode]);
+        report.set("frames", static_cast<double>(frameTimes.size()));
+        report.set("startup_ms", 1000.0 * startupTime);
+        report.set("program_ms", 1000.0 * programTime);
+        report.set("program_cache", programCacheStatus);
+        report.set("frame_ms", summarize_frame_times(frameTimes));
+        report.set("triangles_per_frame", trianglesDrawn / frameTimes.size());
+        report.set("triangles_per_second", trianglesDrawn / totalTime);
+        report.set("indices_per_frame", indicesDrawn / frameTimes.size());
+        if (primitive == GL_LINES) {
+            // the triangle figures count the mesh the edges were taken from
+            report.set("lines_per_frame",
+                       indicesDrawn / 2.0 / frameTimes.size());
+            report.set("lines_per_second", indicesDrawn / 2.0 / totalTime);
+        }
+        report.set("spheres_per_frame", spheresDrawn / frameTimes.size());
+        report.set("submission", indirectDraw ? "indirect" : "instanced");
+        report.set("submit_ms", summarize_frame_times(submitTimes));
+        if (inputReplay.active())
+            report.set("replay_events",
+                       static_cast<double>(inputReplay.events()));
+        if (captureFrames)
+            reportCapture(report, encoder,
+                          encoder.stallSeconds() + readback.waitSeconds());
+        profiler.report(report);
+        if (benchOutput) {
+            ofstream out(benchOutput);
+            report.write(out);
+        }
+        else {
+            report.write(stdoutTaken ? cerr : cout);
+        }
+    }
+
+    profiler.dump(cerr);
+    profiler.destroy();
 
     glfwDestroyWindow(window);
     glfwTerminate();